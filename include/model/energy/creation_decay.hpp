@@ -1,13 +1,121 @@
 #ifndef CREATION_DECAY_H_
 #define CREATION_DECAY_H_
 
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <boost/math/special_functions/airy.hpp>
+#include <boost/math/special_functions/bessel.hpp>
+
 #include "parameters/parameters.hpp"
+#include "utils/dual.hpp"
+#include "utils/types.hpp"
 
 /**
  * Creation rate for massive phi particles in a stiff matter dominated universe.
  */
 double PhiCreationRate(ModelParameters& p, double t);
 
+/**
+ * Logarithmic derivative of the Airy modulus M^2 = Ai^2 + Bi^2. For x <= -20 from the
+ * asymptotic series M^2(-z) ~ (1 + 5/32 z^-3 + 1155/2048 z^-6 + ...) / (pi sqrt(z)), as the
+ * derivatives of Ai and Bi cancel to many digits there.
+ */
+double airyModulusLogDerivative(double x);
+
+// The Airy modulus M^2(x) = Ai^2 + Bi^2.
+template<typename Real>
+Real airyModulusSquared(const Real& x)
+{
+    Real airyAi = boost::math::airy_ai(x);
+    Real airyBi = boost::math::airy_bi(x);
+    return airyAi * airyAi + airyBi * airyBi;
+}
+
+// On dual numbers through the logarithmic derivative.
+template<std::size_t N>
+Dual<N> airyModulusSquared(const Dual<N>& x)
+{
+    double value = airyModulusSquared(x.value);
+    return chain(x, value, value * airyModulusLogDerivative(x.value));
+}
+
+/**
+ * Creation rate 3 (m b)^(13/3) / (32 b) t (Ai^2 + Bi^2)(-(3 m t / 2)^(2/3)), templated on the
+ * scalar type. Shared by PhiParticle and the sensitivity analysis.
+ */
+template<typename Real>
+Real PhiCreationRate(const Real& m, const Real& b, const Real& t)
+{
+    using std::cbrt;
+
+    Real x = 3.0 * m * t / 2.0;
+    Real airySum = airyModulusSquared(-cbrt(x * x));
+
+    // (m b)^(13/3) = (m b)^4 (m b)^(1/3)
+    Real mb = m * b;
+    Real factor = 3.0 * (mb * mb) * (mb * mb) * cbrt(mb) / (32.0 * b);
+
+    return factor * t * airySum;
+}
+
+/**
+ * t^2 / 64 * (J_a^2 - J_(a-1) J_(a+1) - N_(a+1) N_(a-1) + N_a^2)(m t), the decay rate per unit
+ * coupling is its difference between t and t0. Templated on the scalar type.
+ */
+template<typename Real>
+Real decayBesselTerm(const Real& m, const Real& alpha, const Real& t)
+{
+    using boost::math::cyl_bessel_j;
+    using boost::math::cyl_neumann;
+
+    Real arg = m * t;
+    Real factor = t * t / 64;
+
+    Real J_alpha  = cyl_bessel_j(alpha, arg);
+    Real J_alpha1 = cyl_bessel_j(alpha - 1, arg);
+    Real J_alphaP1 = cyl_bessel_j(alpha + 1, arg);
+    Real N_alpha  = cyl_neumann(alpha, arg);
+    Real N_alpha1 = cyl_neumann(alpha - 1, arg);
+    Real N_alphaP1 = cyl_neumann(alpha + 1, arg);
+
+    Real bessel = J_alpha * J_alpha
+                - J_alpha1 * J_alphaP1
+                - N_alphaP1 * N_alpha1
+                + N_alpha * N_alpha;
+    return factor * bessel;
+}
+
+/**
+ * Derivative of decayBesselTerm in the order alpha. A central difference at small m t; above,
+ * where the cancellation swamps the difference, from the asymptotic series of the term.
+ */
+double decayBesselOrderDerivative(double m, double alpha, double t);
+
+/**
+ * decayBesselTerm on dual numbers. The combination cancels to many digits at large m t, and so
+ * do its derivatives when taken term by term. With B = G(m t) / m^2, Lommel's integral gives
+ * G'(x) = x (J_a^2 + N_a^2)(x) / 32 instead.
+ */
+template<std::size_t N>
+Dual<N> decayBesselTerm(const Dual<N>& m, const Dual<N>& alpha, const Dual<N>& t)
+{
+
+    double value = decayBesselTerm<double>(m.value, alpha.value, t.value);
+    double J = boost::math::cyl_bessel_j(alpha.value, m.value * t.value);
+    double Y = boost::math::cyl_neumann(alpha.value, m.value * t.value);
+    double dt = t.value * (J * J + Y * Y) / 32.0;
+    double dm = (t.value * dt - 2.0 * value) / m.value;
+
+    Dual<N> B = chain(t, value, dt);
+    B += chain(m, 0.0, dm);
+    if (!alpha.isConstant())
+    {
+        B += chain(alpha, 0.0, decayBesselOrderDerivative(m.value, alpha.value, t.value));
+    }
+    return B;
+}
+
 /**
  * @brief Computes the decay rate of the massless chi particle as a function of time.
  *
@@ -16,18 +124,59 @@ double PhiCreationRate(ModelParameters& p, double t);
  * Speeds up the computation effectively 715x.
  * Provides a callable interface via operator() to evaluate the full decay rate 
  * at arbitrary time t.
+ *
+ * For t close to t0 the rate is a difference of nearly equal numbers. With
+ * REHEATING_MIXED_PRECISION defined, evaluations whose condition number exceeds
+ * maxCondition are redone in ExtendedPrecision; all other evaluations stay in double.
+ *
+ * Supports several decay channels (ModelParameters::decayChannels). Channels whose decay
+ * products share alpha are grouped, so the total rate costs one set of Bessel functions
+ * per distinct alpha regardless of the number of channels.
  */
 class ChiDecayRate
 {
     private:
+        struct AlphaGroup
+        {
+            double alpha;
+            double couplingSquared;             // Sum of lambda^2 over the channels in the group
+            double initialBessel;               // besselTerm at t0
+            mutable std::optional<ExtendedPrecision> initialBesselExtended;
+        };
+
         const ModelParameters& p;
         double n;
         double t0;
-        double alpha;
-        double initialBessel;
+        std::pmr::vector<AlphaGroup> groups;
+        std::pmr::vector<std::size_t> channelGroup;  // Index of the group of every channel
+        std::pmr::vector<double> channelCoupling;    // lambda^2 of every channel
+
+        void addChannel(double lambda, double xi);
+
+        // decayBesselTerm of this particle's mass in the precision Real.
+        template<typename Real>
+        Real besselTerm(double alpha, const Real& t) const;
+        double groupRate(const AlphaGroup& group, double t) const;
     public:
-        ChiDecayRate(ModelParameters& p_, double n_, double t0_);
+        // Digits lost to cancellation before switching to extended precision: log10(maxCondition).
+        static constexpr double maxCondition = 1e6;
+
+        ChiDecayRate(ModelParameters& p_, double n_, double t0_,
+                     std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+        // Copies keep allocating from the memory resource of the original.
+        ChiDecayRate(const ChiDecayRate& other);
 
+        // Total decay rate of all channels.
         double operator()(double t) const;
+        // Decay rate of a single channel.
+        double channel(std::size_t c, double t) const;
+        /**
+         * @brief Time derivative of the total decay rate.
+         *
+         * By Lommel's integral this is lambda^2 t (J_a^2 + N_a^2)(m t) / 32 per group, two
+         * Bessel functions instead of six and free of cancellation near t0.
+         */
+        double derivative(double t) const;
+        std::size_t channelCount() const;
 };
-#endif
\ No newline at end of file
+#endif
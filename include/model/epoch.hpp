@@ -0,0 +1,83 @@
+#ifndef EPOCH_H_
+#define EPOCH_H_
+
+#include <cmath>
+
+/**
+ * Cosmological epochs with the matter content index n of State.
+ */
+enum class Epoch
+{
+    Minkowski,
+    Stiff,
+    Radiation,
+    Matter
+};
+
+
+/**
+ * @brief Compile-time properties of an epoch.
+ *
+ * The scale factor grows as a(t) ~ t^(n / (n + 2)). a3 and a4 return (t^(n / (n + 2)))^3 and
+ * ^4, the dilution of non-relativistic and relativistic energy densities, with the exponent
+ * folded into cbrt, sqrt and multiplications instead of a generic pow. a3Exponent and
+ * a4Exponent are the powers of t themselves, i.e. the logarithmic derivatives t a3'/a3 etc.
+ * a3 and a4 are templated on the scalar type for the sensitivity analysis.
+ */
+template<Epoch E>
+struct EpochTraits;
+
+template<>
+struct EpochTraits<Epoch::Minkowski>
+{
+    static constexpr double n = 0.0;
+    static constexpr double a3Exponent = 0.0;
+    static constexpr double a4Exponent = 0.0;
+    template<typename Real> static Real a3(const Real&) {return Real(1.0);}
+    template<typename Real> static Real a4(const Real&) {return Real(1.0);}
+};
+
+template<>
+struct EpochTraits<Epoch::Stiff>
+{
+    static constexpr double n = 1.0;
+    static constexpr double a3Exponent = 1.0;
+    static constexpr double a4Exponent = 4.0 / 3.0;
+    template<typename Real> static Real a3(const Real& t) {return t;}
+    template<typename Real> static Real a4(const Real& t)
+    {
+        using std::cbrt;
+        return t * cbrt(t);
+    }
+};
+
+template<>
+struct EpochTraits<Epoch::Radiation>
+{
+    static constexpr double n = 2.0;
+    static constexpr double a3Exponent = 3.0 / 2.0;
+    static constexpr double a4Exponent = 2.0;
+    template<typename Real> static Real a3(const Real& t)
+    {
+        using std::sqrt;
+        return t * sqrt(t);
+    }
+    template<typename Real> static Real a4(const Real& t) {return t * t;}
+};
+
+template<>
+struct EpochTraits<Epoch::Matter>
+{
+    static constexpr double n = 4.0;
+    static constexpr double a3Exponent = 2.0;
+    static constexpr double a4Exponent = 8.0 / 3.0;
+    template<typename Real> static Real a3(const Real& t) {return t * t;}
+    template<typename Real> static Real a4(const Real& t)
+    {
+        using std::cbrt;
+        Real c = cbrt(t);
+        return t * t * c * c;
+    }
+};
+
+#endif
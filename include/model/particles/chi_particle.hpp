@@ -2,6 +2,10 @@
 #define CHI_PARTICLE_H_
 
 #include <memory>
+#include <memory_resource>
+#include <utility>
+#include <optional>
+#include <vector>
 
 #include "parameters/parameters.hpp"
 #include "utils/types.hpp"
@@ -23,21 +27,52 @@ class ChiParticle
     private:
         ModelParameters p;
         std::shared_ptr<PhiParticle> phiParticle;
+        std::pmr::memory_resource* resource;
+        IntegrationUtils::ErrorBudget quadrature;
         double initialRhoMatter;
         double initialRhoRadiation;
+        // Per decay channel initial values, used by the single-channel densities.
+        std::pmr::vector<double> initialRhoMatterChannels;
+        std::pmr::vector<double> initialRhoRadiationChannels;
     public:
-        explicit ChiParticle(const ModelParameters& _p, std::shared_ptr<PhiParticle> phi) :
-        p{_p}, phiParticle(std::move(phi)) {};
+        explicit ChiParticle(const ModelParameters& _p, std::shared_ptr<PhiParticle> phi,
+                             std::pmr::memory_resource* _resource = std::pmr::get_default_resource()) :
+        p{_p}, phiParticle(std::move(phi)), resource{_resource},
+        initialRhoMatterChannels{_resource}, initialRhoRadiationChannels{_resource} {};
   
-        // Returns RhoChiStiff as a function of t.
-        EnergyDensity energyDensityStiff();
-        EnergyDensity energyDensityMatter(double t0);
-        EnergyDensity energyDensityRadiation(double t0);
+        // Switches to new parameters; the initial values of the old ones are cleared.
+        void rebind(const ModelParameters& _p);
+        // Error budget of the density integrals, not counting the error of rho_phi in them.
+        void setErrorBudget(const IntegrationUtils::ErrorBudget& budget);
+        // Returns RhoChiStiff as a function of t. If a channel is given, only the chi
+        // produced through that decay channel is counted.
+        EnergyDensity energyDensityStiff(std::optional<std::size_t> channel = std::nullopt);
+        EnergyDensity energyDensityMatter(double t0, std::optional<std::size_t> channel = std::nullopt);
+        EnergyDensity energyDensityRadiation(double t0, std::optional<std::size_t> channel = std::nullopt);
+        // Time derivatives of the densities above: the integrand at t plus the dilution.
+        EnergyDensityDerivative energyDensityStiffDerivative(std::optional<std::size_t> channel = std::nullopt);
+        EnergyDensityDerivative energyDensityMatterDerivative(double t0, std::optional<std::size_t> channel = std::nullopt);
+        EnergyDensityDerivative energyDensityRadiationDerivative(double t0, std::optional<std::size_t> channel = std::nullopt);
+        std::size_t channelCount() const;
+        /**
+         * @brief Locates the maximum of rho_chi in radiation domination on [t0, tMax] and
+         * integrates rho_chi from t0 up to it.
+         *
+         * The decay source is accumulated once over log-spaced panels. Both the position of
+         * the maximum and the time integral (by parts) follow from the same running sums.
+         *
+         * @return A pair (t_max, integral of rho_chi over [t0, t_max]).
+         */
+        std::pair<double, double> radiationPeak(double t0, double tMax, double tol = 1e-10);
         // Getters and Setters to set initial values once obtained
         void setInitialRhoMatter(const double& rhoInit);
         double getInitialRhoMatter() const;
         void setInitialRhoRadiation(const double& rhoInit);
         double getInitialRhoRadiation() const;
+        void setInitialRhoMatter(const double& rhoInit, std::size_t channel);
+        double getInitialRhoMatter(std::size_t channel) const;
+        void setInitialRhoRadiation(const double& rhoInit, std::size_t channel);
+        double getInitialRhoRadiation(std::size_t channel) const;
 };
 
 
@@ -0,0 +1,61 @@
+#ifndef PHASE_CONTEXT_H_
+#define PHASE_CONTEXT_H_
+
+#include <memory_resource>
+
+#include "model/energy/creation_decay.hpp"
+#include "model/epoch.hpp"
+#include "model/particles/phase_densities.hpp"
+#include "model/particles/phi_particle.hpp"
+
+/**
+ * @brief What the phi and chi densities of one phase share, built once per phase by
+ * PhiParticle::phaseContext.
+ *
+ * Holds the decay rate D from the start t0 of the phase, whose constructor evaluates the
+ * Bessel functions at t0, and the phi density at t0. The density closures of both particles
+ * borrow it, so evaluating a density sets nothing up. In the matter and radiation phases
+ * rho_phi(t) = a^3(t0 / t) e^(-D(t)) rho_phi(t0) also takes a D(t) that the caller has
+ * evaluated anyway, which spares the chi integrands a second set of Bessel functions.
+ */
+template<Epoch E>
+struct PhaseContext
+{
+    using Traits = EpochTraits<E>;
+
+    PhiParticle* phi;
+    double t0;
+    double rhoPhi0;             // Unused in the stiff phase, where rho_phi is an integral from t0
+    ChiDecayRate decay;
+
+    PhaseContext(PhiParticle* phi_, ModelParameters& p, double t0_, double rhoPhi0_,
+                 std::pmr::memory_resource* resource) :
+        phi{phi_}, t0{t0_}, rhoPhi0{rhoPhi0_}, decay{p, Traits::n, t0_, resource} {};
+
+    // rho_phi at t, given decayValue = decay(t).
+    double rhoPhi(double t, double decayValue) const
+    {
+        if constexpr (E == Epoch::Stiff)
+        {
+            return phi->stiffDensity(t, decay);
+        }
+        else
+        {
+            return decayedPhiDensity<E>(t0, t, decayValue, rhoPhi0);
+        }
+    }
+
+    double rhoPhi(double t) const
+    {
+        if constexpr (E == Epoch::Stiff)
+        {
+            return phi->stiffDensity(t, decay);
+        }
+        else
+        {
+            return rhoPhi(t, decay(t));
+        }
+    }
+};
+
+#endif
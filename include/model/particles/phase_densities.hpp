@@ -0,0 +1,67 @@
+#ifndef PHASE_DENSITIES_H_
+#define PHASE_DENSITIES_H_
+
+#include <cmath>
+
+#include "model/epoch.hpp"
+
+/*
+ * The density formulas of the phi and chi particles, templated on the scalar type so that the
+ * particles, the trajectory tracer (on double) and the sensitivity analysis (on Dual) evaluate
+ * the same expressions. D is the decay rate of the phase, which vanishes at its start t0
+ * (ChiDecayRate), and the integrals run from t0.
+ */
+
+/**
+ * Integrand over t' of t rho_phi(t) in the stiff phase, t' C(t') e^(D(t') - D(t)) with the
+ * creation rate C. e^(-D(t)) is folded in so that the exponentials cannot overflow separately
+ * when the decay rate grows large.
+ */
+template<typename Real>
+Real stiffPhiIntegrand(const Real& tprime, const Real& creationRate, const Real& decayDifference)
+{
+    using std::exp;
+    return tprime * creationRate * exp(decayDifference);
+}
+
+// rho_phi in the stiff phase from the integral of stiffPhiIntegrand.
+template<typename Real>
+Real stiffPhiDensity(const Real& integral, const Real& t)
+{
+    return integral / EpochTraits<Epoch::Stiff>::a3(t);
+}
+
+// rho_phi(t) = a^3(t0 / t) e^(-D(t)) rho_phi(t0) in the matter and radiation phases.
+template<Epoch E, typename Real>
+Real decayedPhiDensity(const Real& t0, const Real& t, const Real& decay, const Real& rhoPhi0)
+{
+    using std::exp;
+    return EpochTraits<E>::a3(t0 / t) * exp(-decay) * rhoPhi0;
+}
+
+// Source of a^4 rho_chi: the decay rate times rho_phi a^4.
+template<Epoch E, typename Real>
+Real chiSource(const Real& rate, const Real& rhoPhi, const Real& t)
+{
+    return rate * rhoPhi * EpochTraits<E>::a4(t);
+}
+
+// rho_chi(t) from the integral of chiSource and rho_chi(t0).
+template<Epoch E, typename Real>
+Real chiDensity(const Real& sourceIntegral, const Real& t0, const Real& t, const Real& rhoChi0)
+{
+    return sourceIntegral / EpochTraits<E>::a4(t) + rhoChi0 * EpochTraits<E>::a4(t0 / t);
+}
+
+/**
+ * Integral over [t0, t] of rho_chi = (I + C) / t^2 in the radiation phase, where I and J are
+ * the integrals of chiSource and of chiSource / t, and C = rho_chi(t0) t0^2. By parts, with
+ * I(t0) = 0.
+ */
+template<typename Real>
+Real radiationChiIntegral(const Real& I, const Real& J, const Real& C, const Real& t0, const Real& t)
+{
+    return C / t0 - (I + C) / t + J;
+}
+
+#endif
@@ -2,12 +2,19 @@
 #define PHI_PARTICLE_H_
 
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <mutex>
 #include <optional>
 
+#include "model/epoch.hpp"
 #include "parameters/parameters.hpp"
+#include "utils/integration.hpp"
 #include "utils/types.hpp"
 
+class ChiDecayRate;
+template<Epoch E> struct PhaseContext;
+
 /**
  * @brief Represents the massive Phi particle in the model.
  * 
@@ -20,17 +27,58 @@
 class PhiParticle
 {
     private:
+        struct CachedDensity
+        {
+            double value;
+            double relativeError;       // Quadrature error estimate, recorded again on every hit
+        };
+
         ModelParameters p;
-        std::map<double, double> rhoPhiCache;
+        std::pmr::memory_resource* resource;
+        std::pmr::map<double, CachedDensity> rhoPhiCache;
         std::mutex cacheMutex;
+        IntegrationUtils::ErrorBudget quadrature;
         double initialRhoMatter;
         double initialRhoRadiation;
+        // Contexts of the latest phases, dropped by rebind.
+        std::shared_ptr<const PhaseContext<Epoch::Stiff>> stiffContext;
+        std::shared_ptr<const PhaseContext<Epoch::Matter>> matterContext;
+        std::shared_ptr<const PhaseContext<Epoch::Radiation>> radiationContext;
+
+        template<Epoch E> std::shared_ptr<const PhaseContext<E>>& cachedContext();
+        // rho_phi in the stiff phase, with the decay rate of its context.
+        double stiffDensity(double t, const ChiDecayRate& decay);
+
+        template<Epoch E> friend struct PhaseContext;
     public:
-        explicit PhiParticle(const ModelParameters& _p) : p{_p} {};
+        explicit PhiParticle(const ModelParameters& _p,
+                             std::pmr::memory_resource* _resource = std::pmr::get_default_resource()) :
+        p{_p}, resource{_resource}, rhoPhiCache{_resource} {};
+        /**
+         * @brief Switches to new parameters, keeping the cache storage.
+         *
+         * Cached densities are dropped only if a parameter they depend on changed.
+         */
+        void rebind(const ModelParameters& _p);
+        // Error budget of the stiff density integral; a new budget drops the cached densities.
+        void setErrorBudget(const IntegrationUtils::ErrorBudget& budget);
         double creationRate(double t);
+        /**
+         * @brief Decay rate and phi density of the phase of epoch E starting at t0 (p.t0 for
+         * the stiff phase), for the densities of both particles to share.
+         *
+         * Built on the first call for a phase and returned again until the parameters, t0 or
+         * the initial density change. The initial density is read when the context is built.
+         */
+        template<Epoch E>
+        std::shared_ptr<const PhaseContext<E>> phaseContext(double t0);
         EnergyDensity energyDensityStiff();
         EnergyDensity energyDensityMatter(double t0);
         EnergyDensity energyDensityRadiation(double t0);
+        // Time derivatives of the densities above, from their integrands and prefactors.
+        EnergyDensityDerivative energyDensityStiffDerivative();
+        EnergyDensityDerivative energyDensityMatterDerivative(double t0);
+        EnergyDensityDerivative energyDensityRadiationDerivative(double t0);
         // Getters and Setters to set initial values once obtained
         void setInitialRhoMatter(const double& rhoInit);
         double getInitialRhoMatter() const;
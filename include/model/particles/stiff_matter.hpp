@@ -16,6 +16,7 @@ class StiffMatter final
         ModelParameters p;
     public:
         explicit StiffMatter(const ModelParameters& _p) : p{_p} {};
+        void rebind(const ModelParameters& _p) {p = _p;};
     /**
      * @brief Returns a callable function representing the energy density over time.
      * 
@@ -25,6 +26,8 @@ class StiffMatter final
      * @return EnergyDensity function (HighPrecision -> HighPrecision)
      */
         EnergyDensity energyDensity();
+        // d rho / dt = -2 rho / t
+        EnergyDensityDerivative energyDensityDerivative();
 };
 
 #endif
\ No newline at end of file
@@ -2,10 +2,21 @@
 #define PARAMS_H_
 
 #include <cmath>
+#include <compare>
 #include <string>
 #include <iostream>
+#include <vector>
 #include <utils/types.hpp>
 
+struct DecayChannel
+{
+    double lambda;                              // Coupling constant of the channel << 1.
+    double xi;                                  // Gravitational coupling of the decay product.
+
+    auto operator<=>(const DecayChannel&) const = default;
+};
+
+
 struct ModelParameters
 {
     double t0 = double(1.51926764e-8); // Initial time in GeV^-1
@@ -14,17 +25,42 @@ struct ModelParameters
     double b;                                   // Dimensionless expansion parameter.
     double xi;                                  // Gravitational coupling.
     double G_N = double(1.683e-37);    // Gravitational constant in GeV^-2
+    // Decay channels of phi. If empty, phi decays through the single channel (lambda, xi).
+    std::vector<DecayChannel> channels;
     // Universe matter content; n = 0 Minkowskian, n = 1 stiff, n = 2 radiation, n = 4 matter.
     double alpha(double n);
+    // Templated on the scalar type for the sensitivity analysis (utils/dual.hpp).
+    template<typename Real>
+    static Real alpha(double n, const Real& xi);
+    std::vector<DecayChannel> decayChannels() const;
+
+    // Ordered member by member, so parameter sets can key associative containers.
+    auto operator<=>(const ModelParameters&) const = default;
 };
 
 
 inline double ModelParameters::alpha(double n)
 {
+    return alpha(n, xi);
+}
+
+template<typename Real>
+inline Real ModelParameters::alpha(double n, const Real& xi)
+{
+    using std::sqrt;
     return sqrt(double(1.0) - n*(n - double(2.0))
            * (double(6.0)*xi - double(1.0))) / (double(2.0) + n);
 }
 
+inline std::vector<DecayChannel> ModelParameters::decayChannels() const
+{
+    if (channels.empty())
+    {
+        return {DecayChannel{lambda, xi}};
+    }
+    return channels;
+}
+
 
 struct State
 {
@@ -0,0 +1,59 @@
+#ifndef ADAPTIVE_MASS_SWEEP_H_
+#define ADAPTIVE_MASS_SWEEP_H_
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+#include "writers/results_writer.hpp"
+
+
+struct AdaptiveSweepSettings
+{
+    double mMin = 1e0;                  // Lower end of the mass range in GeV
+    double mMax = 1e28;                 // Upper end of the mass range in GeV
+    int coarsePointsPerDecade = 2;      // Density of the initial mass ladder
+    int maxDepth = 6;                   // Maximum number of bisections of a coarse interval
+    double tolerance = 0.02;            // Allowed change of log10(T_RH) and log10(t_eq) between neighbours
+    PrecisionTargets precision{};       // Of every simulation
+};
+
+
+/**
+ * @brief Runs a mass sweep that refines only where the results change.
+ *
+ * For every (lambda, xi, b) slice, starts from a coarse logarithmic mass ladder and bisects
+ * (geometrically) the intervals whose end points differ by more than the tolerance in
+ * log10(T_RH) or log10(t_eq), or whose toMatter/bothFound flags flip. Each refinement round is
+ * run on a SimulationManager pool; all results are forwarded to the given writer.
+ */
+class AdaptiveMassSweep
+{
+    private:
+        std::vector<ModelParameters> slices;
+        std::unique_ptr<ResultsWriter> writer;
+        AdaptiveSweepSettings settings;
+        std::size_t workerCount;
+        std::size_t simulationCount = 0;
+
+        std::vector<SimulationResults> runRound(std::vector<ModelParameters> batch);
+        bool needsRefinement(const SimulationResults& a, const SimulationResults& b) const;
+
+    public:
+        /**
+         * @param slices One entry per (lambda, xi, b) combination; the mass is ignored.
+         */
+        AdaptiveMassSweep(std::vector<ModelParameters> slices,
+                          std::unique_ptr<ResultsWriter> writer,
+                          AdaptiveSweepSettings settings = {},
+                          std::size_t workerCount = std::thread::hardware_concurrency());
+        void run();
+
+        // Number of simulations run so far.
+        std::size_t getSimulationCount() const;
+};
+
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef ANALYTIC_ESTIMATE_H_
+#define ANALYTIC_ESTIMATE_H_
+
+#include <optional>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+
+/**
+ * @brief Predicts the Outputs::Default results from the leading-order forms of the rates.
+ *
+ * For m t >> 1 the creation rate tends to K t^(2/3), K = 3 (m b)^(13/3) (2 / (3 m))^(1/3)
+ * / (32 pi b), and the decay rate of every phase to Gamma (t - t_start), Gamma = lambda^2 /
+ * (16 pi m) whatever alpha. With these the stiff phase densities are power laws in the
+ * limits Gamma t << 1 and Gamma t >> 1, and the matter and radiation phases have closed forms
+ * in incomplete gamma functions. The equalities and the reheating peak then cost a few root
+ * searches on elementary functions instead of nested integrals.
+ *
+ * The relative error of t_eq, tau_eq and T_RH is estimated from the size of the neglected
+ * terms: Gamma t or 1 / (Gamma t) in the stiff phase, 1 / (m t) in the asymptotic rates and
+ * (t0 / t)^(8/3) for the start of the creation integral. The estimate is only meant to sort
+ * points of a sweep; where it is unreliable the points need a full Simulation::run.
+ */
+class AnalyticEstimate
+{
+    private:
+        ModelParameters p;
+        double K;           // Creation rate / t^(2/3)
+        double gamma;       // Decay rate / (t - t_start)
+        double S;           // Stiff matter density * t^2
+
+    public:
+        explicit AnalyticEstimate(const ModelParameters& p_);
+
+        /**
+         * @brief Results with approximate set and approximationError filled in.
+         *
+         * @return nullopt where the point cannot be classified: several decay channels,
+         * stiff equality times within their errors of each other (the toMatter boundary), a
+         * stiff equality before t0, or no matter equality.
+         */
+        std::optional<SimulationResults> run() const;
+};
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <thread>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+#include "storage/result_store.hpp"
+#include "utils/budget.hpp"
+
+/**
+ * @brief Options of simulateBatch.
+ *
+ * progress is called after every finished simulation with the number of finished and of
+ * all simulations. It runs on a worker thread, one call at a time. If store is set, points
+ * found in it at the same precision are not recomputed and new results are added to it.
+ */
+struct BatchOptions
+{
+    std::size_t threads = std::thread::hardware_concurrency();
+    unsigned outputs = Outputs::Default;
+    PrecisionTargets precision{};
+    TaskBudget budget{};
+    ResultStore* store = nullptr;
+    std::function<void(std::size_t done, std::size_t total)> progress;
+};
+
+
+/**
+ * @brief Runs one simulation per parameter set on a worker pool, in process.
+ *
+ * results[i] receives the results of params[i]. Simulations that fail or exceed the budget
+ * still fill their slot, with the status set accordingly.
+ *
+ * @throws std::invalid_argument if results and params differ in size.
+ */
+void simulateBatch(std::span<const ModelParameters> params,
+                   std::span<SimulationResults> results,
+                   const BatchOptions& options = {});
+
+
+#endif
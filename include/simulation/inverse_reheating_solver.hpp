@@ -0,0 +1,92 @@
+#ifndef INVERSE_REHEATING_SOLVER_H_
+#define INVERSE_REHEATING_SOLVER_H_
+
+#include <map>
+#include <vector>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+#include "utils/budget.hpp"
+
+
+struct InverseSolverSettings
+{
+    double mMin = 1e0;                  // Lower end of the mass range in GeV
+    double mMax = 1e28;                 // Upper end of the mass range in GeV
+    int scanPointsPerDecade = 1;        // Density of the scan that brackets the solutions
+    double temperatureTolerance = 1e-6; // Required |T_RH / target - 1|
+    double massTolerance = 1e-6;        // Bracket width mHigh / mLow - 1 at which to stop
+    int maxIterations = 60;             // Simulations per bracket after the scan
+    TaskBudget budget{.seconds = 120.0};    // Per simulation; an exceeded one counts as failed
+};
+
+
+/**
+ * A mass at which T_RH reaches the target, with the bracket and errors it was found with.
+ */
+struct InverseSolution
+{
+    ModelParameters params;             // params.m: the solution
+    double mLow;                        // Final bracket in m
+    double mHigh;
+    double reheatingTemp;               // T_RH simulated at params.m
+    double temperatureError;            // |reheatingTemp / target - 1|
+    bool toMatter;                      // At params.m
+    bool atSwitch;                      // T_RH jumps past the target where toMatter flips
+    bool converged;                     // False if a simulation in the bracket failed or the
+                                        // iterations ran out before either tolerance
+};
+
+
+/**
+ * @brief Finds the masses at which T_RH takes a target value in one (lambda, xi, b) slice.
+ *
+ * A logarithmic scan in m brackets every sign change of log T_RH - log target, and each
+ * bracket is narrowed with Illinois steps in log m, falling back to bisection whenever two
+ * steps fail to halve it. T_RH jumps where the toMatter flag flips; a bracket that closes on
+ * such a jump instead of a root is reported with atSwitch set, narrowed to massTolerance.
+ *
+ * The simulations run one after another on a single Simulation that is rebound to every mass,
+ * at the precision the tolerance needs. Their results are kept, so that solving for several
+ * targets of a slice reuses the scan.
+ */
+class InverseReheatingSolver
+{
+    private:
+        struct Evaluation
+        {
+            bool ok;
+            double reheatingTemp;
+            bool toMatter;
+        };
+
+        ModelParameters slice;
+        InverseSolverSettings settings;
+        Simulation simulation;
+        std::map<double, Evaluation> evaluations;   // By m
+        std::vector<double> scan;                   // Masses of the scan
+        std::size_t simulationCount = 0;
+
+        const Evaluation& evaluate(double m);
+        InverseSolution refine(double mLow, double mHigh, double target);
+
+    public:
+        /**
+         * @param slice Parameters of the slice; the mass is ignored.
+         */
+        explicit InverseReheatingSolver(const ModelParameters& slice, InverseSolverSettings settings = {});
+
+        /**
+         * @brief Solutions of T_RH(m) = targetTemperature in increasing m.
+         *
+         * Solutions closer together than the scan spacing are found only if T_RH crosses the
+         * target an odd number of times between two scan points.
+         */
+        std::vector<InverseSolution> solve(double targetTemperature);
+
+        // Number of simulations run so far.
+        std::size_t getSimulationCount() const;
+};
+
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PHASE_BOUNDARY_TRACER_H_
+#define PHASE_BOUNDARY_TRACER_H_
+
+#include <thread>
+#include <vector>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+
+
+struct BoundaryTracerSettings
+{
+    double mMin = 1e0;                  // Lower end of the mass range in GeV
+    double mMax = 1e28;                 // Upper end of the mass range in GeV
+    int scanPointsPerDecade = 1;        // Density of the scan that brackets the transitions
+    double tolerance = 1e-3;            // Required relative width mHigh / mLow - 1 of a bracket
+    PrecisionTargets precision{};       // Of every simulation
+};
+
+
+/**
+ * A point on the boundary between matter-first and radiation-first evolution.
+ * params.m holds the transition mass estimate (geometric mean of the final bracket).
+ */
+struct BoundaryPoint
+{
+    ModelParameters params;
+    double mLow;
+    double mHigh;
+    bool toMatterBelow;                 // toMatter at mLow
+    bool converged;                     // False if a simulation inside the bracket failed
+};
+
+
+/**
+ * @brief Traces the toMatter transition mass in the (m, lambda) plane.
+ *
+ * For every (lambda, xi, b) slice, a coarse logarithmic scan in m brackets each flip of the
+ * toMatter flag, and every bracket is then bisected in log m until it is narrower than the
+ * tolerance. All brackets of all slices advance together, one simulation each per round,
+ * on a SimulationManager pool.
+ */
+class PhaseBoundaryTracer
+{
+    private:
+        std::vector<ModelParameters> slices;
+        BoundaryTracerSettings settings;
+        std::size_t workerCount;
+        std::size_t simulationCount = 0;
+
+        std::vector<SimulationResults> runRound(std::vector<ModelParameters> batch);
+
+    public:
+        /**
+         * @param slices One entry per (lambda, xi, b) combination; the mass is ignored.
+         */
+        PhaseBoundaryTracer(std::vector<ModelParameters> slices,
+                            BoundaryTracerSettings settings = {},
+                            std::size_t workerCount = std::thread::hardware_concurrency());
+        std::vector<BoundaryPoint> run();
+
+        // Number of simulations run so far.
+        std::size_t getSimulationCount() const;
+};
+
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef SENSITIVITY_H_
+#define SENSITIVITY_H_
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+#include "utils/integration.hpp"
+
+/**
+ * @brief Gradients of the results of Simulation::run with respect to (m, lambda, b, xi).
+ *
+ * Re-evaluates the densities on dual numbers (utils/dual.hpp) at the times the double run
+ * found, instead of running the simulation again at shifted parameters. The densities share
+ * their formulas (model/particles/phase_densities.hpp) and special functions with the
+ * particles, and their quadratures the adaptive rule and the error budgets of the double
+ * run, on limits mapped to [0, 1] so that moving limits are differentiated as well. The equality times and the reheating peak are roots
+ * h(t, theta) = 0; their derivatives follow from the implicit function theorem,
+ * dt/dtheta = -h_theta / h_t, with h_t from one more dual direction seeded on t.
+ *
+ * Only single channel parameters are supported. At xi = 0 the stiff-phase order alpha has a
+ * square root branch point, so the xi derivatives are not finite there.
+ */
+class SensitivityAnalysis
+{
+    private:
+        ModelParameters p;
+        IntegrationUtils::ErrorBudget densityBudget;    // Of rho_phi and rho_chi together
+        IntegrationUtils::ErrorBudget peakBudget;       // Of the integrals of the radiation phase
+
+    public:
+        /**
+         * @param densities, peak The budgets the run used, see Simulation::setPrecision.
+         */
+        explicit SensitivityAnalysis(const ModelParameters& p_,
+                                     const IntegrationUtils::ErrorBudget& densities = {},
+                                     const IntegrationUtils::ErrorBudget& peak = {})
+            : p{p_}, densityBudget{densities}, peakBudget{peak} {};
+
+        /**
+         * @brief Fills the gradient fields of res, which must hold the Outputs::Default
+         * results of a run with the same parameters.
+         *
+         * @throws std::invalid_argument for parameters with several decay channels.
+         */
+        void apply(SimulationResults& res) const;
+};
+
+#endif
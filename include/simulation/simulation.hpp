@@ -1,50 +1,183 @@
 #ifndef SIMULATION_H_
 #define SIMULATION_H_
 
+#include <array>
+#include <limits>
 #include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
 
 #include "model/energy/creation_decay.hpp"
 #include "model/particles/chi_particle.hpp"
 #include "model/particles/phi_particle.hpp"
 #include "model/particles/stiff_matter.hpp"
 #include "parameters/parameters.hpp"
+#include "solvers/equal_time_solver.hpp"
+#include "utils/integration.hpp"
+#include "utils/profiler.hpp"
 
 
+/**
+ * Groups of SimulationResults fields that a caller can ask Simulation::run for. Only the
+ * phases feeding the requested groups are run; fields of skipped phases are left NaN.
+ */
+namespace Outputs
+{
+    enum : unsigned
+    {
+        StiffEquality     = 1u << 0,    // t_eq, densities at t_eq, toMatter, bothFound
+        MatterEquality    = 1u << 1,    // tau_eq, rhoPhiMatEq, rhoChiMatEq
+        Reheating         = 1u << 2,    // reheating_temp, reheating_time
+        RadiationEquality = 1u << 3,    // t_eq_rad, rhoPhiRadEq, rhoChiRadEq
+        Sensitivities     = 1u << 4,    // Gradients of the Default outputs; implies Default
+        Default = StiffEquality | MatterEquality | Reheating,
+        All = Default | RadiationEquality
+    };
+}
+
+
+enum class SimulationStatus
+{
+    Ok,
+    OverBudget,         // Abandoned after exceeding its time or evaluation budget
+    Failed,             // The simulation threw; the reason is logged to stderr
+    NoStiffEquality,    // Neither phi nor chi reaches the stiff density
+    NoMatterEquality,   // rho_chi does not catch up with rho_phi in the matter phase
+    NonFinite,          // A density became NaN or infinite (special function out of range)
+    NotConverged,       // A root search hit its iteration limit
+};
+
+const char* statusName(SimulationStatus status);
+
+
+/**
+ * @brief Relative precision asked of the results of a simulation.
+ *
+ * The error budgets of all quadratures follow from these, so that no integral is resolved
+ * more finely than the results need. Looser targets make every run cheaper.
+ */
+struct PrecisionTargets
+{
+    double equalityTime = 1e-8;     // t_eq, tau_eq and t_eq_rad
+    double reheatingTemp = 1e-8;    // T_RH
+
+    bool operator==(const PrecisionTargets&) const = default;
+};
+
+
+// Derivatives with respect to (m, lambda, b, xi), in this order.
+using Gradient = std::array<double, 4>;
+
 struct SimulationResults
 {
+    static constexpr double notComputed = std::numeric_limits<double>::quiet_NaN();
+    static constexpr Gradient gradientNotComputed{notComputed, notComputed, notComputed, notComputed};
+
     // Original model parameters
     ModelParameters params;
     // Calculated quantities
-    double reheating_temp;
-    double reheating_time;
-    double t_eq;
-    double rhoStiff_t_eq;
-    double rhoPhiStiff_t_eq;
-    double rhoChi_t_eq;
-    double tau_eq;
-    double rhoPhiMatEq;
-    double rhoChiMatEq;
-    bool toMatter;
-    bool bothFound;
+    double reheating_temp = notComputed;
+    double reheating_time = notComputed;
+    double t_eq = notComputed;
+    double rhoStiff_t_eq = notComputed;
+    double rhoPhiStiff_t_eq = notComputed;
+    double rhoChi_t_eq = notComputed;
+    double tau_eq = notComputed;
+    double rhoPhiMatEq = notComputed;
+    double rhoChiMatEq = notComputed;
+    bool toMatter = false;
+    bool bothFound = false;
+    // Chi energy density of every decay channel at t_eq and tau_eq.
+    // Only filled when phi has more than one decay channel.
+    std::vector<double> rhoChiChannels_t_eq;
+    std::vector<double> rhoChiChannelsMatEq;
+    // Equality of phi and chi in the radiation phase (Outputs::RadiationEquality only).
+    double t_eq_rad = notComputed;
+    double rhoPhiRadEq = notComputed;
+    double rhoChiRadEq = notComputed;
+    // Gradients (Outputs::Sensitivities only, single decay channel only).
+    Gradient dReheatingTemp = gradientNotComputed;
+    Gradient dReheatingTime = gradientNotComputed;
+    Gradient dt_eq = gradientNotComputed;
+    Gradient dtau_eq = gradientNotComputed;
+    // Relative quadrature error estimates of the density ratios at t_eq and tau_eq and of the
+    // rho_chi peak behind T_RH, each including the errors carried in from earlier phases.
+    // They move t_eq and tau_eq by about the same relative amount and T_RH by a quarter.
+    double t_eqQuadratureError = notComputed;
+    double tau_eqQuadratureError = notComputed;
+    double reheatingQuadratureError = notComputed;
+    // An equality search found more than one crossing of the densities in its bracket and
+    // took the earliest (see EqualTime::crossings).
+    bool multipleCrossings = false;
+    // Predicted by AnalyticEstimate instead of simulated, with the estimated relative error of
+    // t_eq, tau_eq and T_RH.
+    bool approximate = false;
+    double approximationError = notComputed;
+    // Unless Ok, the fields of the failing phase and all later ones are left notComputed.
+    SimulationStatus status = SimulationStatus::Ok;
+    // Allocations made through the simulation's memory resource (SimulationManager workers).
+    std::size_t allocations = 0;
+    std::size_t allocatedBytes = 0;
+    // Time and hardware counters per phase (SimulationManager::setProfiling only).
+    std::optional<RunProfile> profile;
 };
 
 
 class Simulation
 {
     private:
-        const ModelParameters& p;
+        ModelParameters p;
         std::shared_ptr<PhiParticle> phi;
         ChiParticle chi;
         StiffMatter stiff;
+        double reheatingTolerance;      // Relative, of the rho_chi integrals in radiationPeak
+        IntegrationUtils::ErrorBudget densityBudget;    // Of rho_phi and rho_chi together
+
+        struct StiffEquality
+        {
+            SimulationStatus status;
+            bool toMatter;
+            double t_eq;
+            double rhoStiffEq;
+            double rhoEq;           // rho_phi if toMatter, otherwise rho_chi
+            bool bothFound;
+            double densityError;    // EqualTime::densityError
+            bool multipleCrossings;
+        };
+
         bool toMatter(const EnergyDensity &rhoChi, double rhoPhi, double timeEquality);
-        std::tuple<double, double, double> runMatterPhase(double t0);
-        std::tuple<double, double, double> runRadiationPhase(double t0);
+        EqualTime runMatterPhase(double t0);
+        EqualTime runRadiationPhase(double t0);
         std::pair<double, double> getReheatingTemperatureAndTime(double t_eq);
-        std::tuple<bool, double, double, double, bool> runStiffPhase();
+        StiffEquality runStiffPhase();
 
     public:
-        Simulation(const ModelParameters& p_);
-        SimulationResults run();
+        /**
+         * @param resource Memory resource for everything the simulation allocates; must
+         * outlive the simulation.
+         */
+        Simulation(const ModelParameters& p_,
+                   std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+        /**
+         * @brief Reuses this simulation for new parameters.
+         *
+         * Keeps the particles, their memory and those cached densities that do not depend
+         * on the changed parameters, so consecutive tasks avoid rebuilding everything.
+         */
+        void rebind(const ModelParameters& p_);
+        /**
+         * @brief Sets the error budgets of all quadratures from the precision asked of the
+         * results. Results keep their precision across rebind.
+         */
+        void setPrecision(const PrecisionTargets& targets);
+        /**
+         * @brief Runs the phases needed for the requested outputs.
+         *
+         * @param outputs Bitwise or of Outputs flags.
+         */
+        SimulationResults run(unsigned outputs = Outputs::Default);
 };
 
 
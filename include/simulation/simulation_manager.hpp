@@ -7,9 +7,12 @@
 #include <condition_variable>
 #include <atomic>
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "simulation/simulation.hpp"
+#include "storage/result_store.hpp"
+#include "utils/budget.hpp"
 #include "writers/results_writer.hpp"
 
 /**
@@ -17,14 +20,43 @@
  *
  * Coordinates the execution of multiple simulations in parallel using a worker thread pool.
  * Distributes simulation tasks from a shared queue and writes the results to a file.
+ *
+ * run() processes the tasks given to the constructor and returns when all are done. For a
+ * resident pool, start() launches the workers, submit() adds tasks while they run and
+ * close() waits for the queue to drain.
+ *
+ * Optionally every task runs under a TaskBudget. A task that exceeds it is abandoned and
+ * either re-queued at the end with a larger budget or written with status OverBudget.
+ *
+ * With a ResultStore attached, tasks already in the store are answered from it without
+ * running, and every newly finished simulation is added to it.
+ *
+ * With profiling enabled every result carries a RunProfile of its phases. Profiled tasks
+ * always run, even if the store has their results.
+ *
+ * Every simulation runs at the PrecisionTargets given to setPrecision; stored results are
+ * only reused for the same targets.
+ *
+ * With triage enabled, tasks not found in the store are first estimated analytically
+ * (AnalyticEstimate). Estimates within the allowed error are written instead of running the
+ * simulation; only the remaining points, near phase boundaries or where the asymptotic
+ * forms do not hold, are simulated.
  */
 class SimulationManager
 {
     private:
+        struct Task
+        {
+            ModelParameters params;
+            int attempt = 0;                // Number of earlier over-budget attempts
+        };
+
         // Task queue
-        std::deque<ModelParameters> tasks;
+        std::deque<Task> tasks;
         std::mutex queueMtx;
         std::condition_variable cv;
+        int tasksInFlight = 0;              // Popped but not finished; these may be re-queued
+        bool closed = false;                // No more submissions; stop once the queue drains
         // Workers
         std::vector<std::thread> workers;
         std::atomic<bool> stop{false};
@@ -33,14 +65,70 @@ class SimulationManager
         // Counter
         std::atomic<int> simulationCounter{0};
         int totalSimulationCount = 0;
+        bool reportProgress = true;
+        // Requested Outputs of every simulation
+        unsigned outputs;
+        PrecisionTargets precision;
+        // Budget per task
+        TaskBudget budget;
+        int budgetRetries = 0;
+        double budgetRetryScale = 4.0;
+        // Persistent results (not owned)
+        ResultStore* store = nullptr;
+        bool profiling = false;
+        // Largest relative error of an estimate written instead of a simulation
+        std::optional<double> triageTolerance;
 
         void workerLoop();
+        // Returns a popped task to the queue or marks it done.
+        void finishTask(Task& task, bool requeue);
 
     public:
         SimulationManager(std::vector<ModelParameters> params,
                           std::unique_ptr<ResultsWriter> writer,
-                          std::size_t workerCount = std::thread::hardware_concurrency());
+                          std::size_t workerCount = std::thread::hardware_concurrency(),
+                          unsigned outputs = Outputs::Default);
         void run();
+        void start();
+        void submit(ModelParameters params);
+        void close();
+        // Print "Simulation: i/N" after every task (default on).
+        void setProgressOutput(bool enabled);
+
+        /**
+         * @brief Limits the time and evaluations each task may use.
+         *
+         * @param retries How often an over-budget task is re-queued at the end of the queue.
+         * @param retryScale Factor by which the budget grows on every retry.
+         */
+        void setBudget(TaskBudget budget, int retries = 0, double retryScale = 4.0);
+        // Precision of every simulation (default: PrecisionTargets{}).
+        void setPrecision(const PrecisionTargets& targets);
+        // Reuse and record results in store, which must outlive the run.
+        void setResultStore(ResultStore* store);
+        // Attach a RunProfile to every result (see Profiler).
+        void setProfiling(bool enabled);
+        /**
+         * @brief Answers tasks whose analytic estimate is within maxError (relative) with the
+         * estimate, marked approximate, instead of simulating them.
+         *
+         * Only applies if the requested outputs are within Outputs::Default and profiling is
+         * off. Estimates are not added to the result store.
+         */
+        void setTriage(double maxError);
+
+        /**
+         * @brief Runs a batch of simulations on a temporary pool and returns their results.
+         *
+         * Used by drivers that choose further parameter points from earlier results. Failed
+         * simulations are missing from the returned vector. Every result, failed ones
+         * included, is also written to forward, if given.
+         */
+        static std::vector<SimulationResults> runBatch(std::vector<ModelParameters> params,
+                                                       ResultsWriter* forward = nullptr,
+                                                       std::size_t workerCount = std::thread::hardware_concurrency(),
+                                                       unsigned outputs = Outputs::Default,
+                                                       const PrecisionTargets& precision = {});
 };
 
 
@@ -0,0 +1,59 @@
+#ifndef SIMULATION_SERVICE_H_
+#define SIMULATION_SERVICE_H_
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "simulation/simulation_manager.hpp"
+
+/**
+ * @brief Resident service that answers parameter queries line by line.
+ *
+ * Every request line holds whitespace separated key=value pairs; comma separated values
+ * expand to the Cartesian product:
+ *
+ *     id=q1 m=1e3,1e4,1e5 lambda=0.01 b=1 xi=0
+ *
+ * m, lambda, b and xi are required, t0 and G_N optional, id defaults to a running number.
+ * All points go onto one SimulationManager pool that lives as long as the service. Each
+ * result is written as soon as it completes, as "q1,<CSVWriter row>", and "# done q1"
+ * follows the last point of a request. Malformed lines are answered with "# error ...".
+ * "quit" or the end of the input drains the queue and stops the service.
+ */
+class SimulationService
+{
+    private:
+        class StreamWriter;
+        std::istream& in;
+        std::ostream& out;
+        std::mutex outMtx;
+        std::map<ModelParameters, std::deque<std::string>> pending; // Request ids waiting per point
+        std::map<std::string, std::size_t> remaining;              // Open points per request id
+        SimulationManager manager;
+        std::size_t requestCounter = 0;
+
+        void deliver(const SimulationResults& res);
+
+    public:
+        SimulationService(std::istream& in, std::ostream& out,
+                          std::size_t workerCount = std::thread::hardware_concurrency(),
+                          unsigned outputs = Outputs::Default,
+                          const PrecisionTargets& precision = {});
+        void run();
+
+        /**
+         * @brief Expands one request line into parameter points.
+         *
+         * @param id Set to the id of the request if it has one; left unchanged otherwise.
+         * @throws std::invalid_argument on malformed input.
+         */
+        static std::vector<ModelParameters> parseRequest(const std::string& line, std::string& id);
+};
+
+
+#endif
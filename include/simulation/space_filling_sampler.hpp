@@ -0,0 +1,71 @@
+#ifndef SPACE_FILLING_SAMPLER_H_
+#define SPACE_FILLING_SAMPLER_H_
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "parameters/parameters.hpp"
+
+
+enum class SamplingMethod
+{
+    Sobol,              // Sobol sequence (Joe-Kuo direction numbers)
+    Halton,             // Halton sequence in bases 2, 3 and 5
+    LatinHypercube,     // One point per stratum of every axis, for a fixed point budget
+};
+
+
+struct SamplerSettings
+{
+    SamplingMethod method = SamplingMethod::Sobol;
+    // Ranges of m [GeV], lambda and b; sampled uniformly in their logarithm.
+    double mMin = 1e0;
+    double mMax = 1e28;
+    double lambdaMin = 1e-7;
+    double lambdaMax = 1e-1;
+    double bMin = 1e-1;
+    double bMax = 1e1;
+    std::uint64_t budget = 1000;        // Number of points; fixes the strata of LatinHypercube
+    std::uint64_t seed = 0;             // Permutations and jitter of LatinHypercube
+};
+
+
+/**
+ * @brief Covers the (log m, log lambda, log b) box evenly with a given number of points.
+ *
+ * Point i depends only on i and the settings, so a sampling run can be resumed from any index
+ * and split between machines by index range. The other parameters, xi included, are taken
+ * from the base parameters.
+ *
+ * Sobol and Halton points are prefixes of infinite sequences: any budget is evenly spread and
+ * the budget can be raised later without discarding points. A Latin hypercube stratifies
+ * every axis exactly for its budget; changing the budget or seed gives a different design.
+ */
+class SpaceFillingSampler
+{
+    private:
+        static constexpr std::size_t dimensions = 3;
+        ModelParameters base;
+        SamplerSettings settings;
+        // Latin hypercube stratum of every point along every axis.
+        std::array<std::vector<std::uint64_t>, dimensions> strata;
+
+        std::array<double, dimensions> unitPoint(std::uint64_t index) const;
+
+    public:
+        SpaceFillingSampler(const ModelParameters& base, SamplerSettings settings = {});
+
+        /**
+         * @brief The point with the given index.
+         *
+         * @throws std::out_of_range for LatinHypercube indices beyond the budget.
+         */
+        ModelParameters point(std::uint64_t index) const;
+
+        // Points first, first + 1, ... up to the budget.
+        std::vector<ModelParameters> points(std::uint64_t first = 0) const;
+};
+
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TRAJECTORY_H_
+#define TRAJECTORY_H_
+
+#include <functional>
+
+#include "model/epoch.hpp"
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+
+
+struct TrajectoryPoint
+{
+    Epoch epoch;
+    double t;
+    double rhoStiff;
+    double rhoPhi;
+    double rhoChi;
+};
+
+
+struct TrajectorySettings
+{
+    int panelsPerDecade = 10;       // Coarse log time grid of every phase
+    double maxLogStep = 0.25;       // Bisect a panel while a density changes more than this in log10
+    int maxDepth = 6;               // Bisections of a coarse panel at most
+    double endFactor = 10.0;        // The radiation phase is traced up to endFactor * t_RH
+};
+
+
+/**
+ * @brief Traces rho_stiff, rho_phi and rho_chi through all phases of a finished simulation.
+ *
+ * Instead of evaluating the EnergyDensity closures on a time grid, which repeats the nested
+ * integrals from t0 for every point, each phase is swept once from its start: the running
+ * integrals of the densities are carried from panel to panel, so every panel only integrates
+ * over itself. Within a panel the kernels are sampled once at Chebyshev nodes; the running
+ * creation integral at those nodes gives rho_phi there, and with it the chi source, so the
+ * nested integral of the stiff phase costs no more than a single one. Later phases start from
+ * the equality values of the SimulationResults, so their curves join the reported points.
+ *
+ * The grid is logarithmic and bisected where a density changes faster than maxLogStep.
+ */
+class TrajectoryTracer
+{
+    private:
+        ModelParameters p;
+        TrajectorySettings settings;
+
+    public:
+        explicit TrajectoryTracer(const ModelParameters& p_, TrajectorySettings settings_ = {})
+            : p{p_}, settings{settings_} {};
+
+        /**
+         * @brief Calls sink for every point, in increasing time.
+         *
+         * @param res Outputs::Default results of a run with the same parameters.
+         */
+        void trace(const SimulationResults& res, const std::function<void(const TrajectoryPoint&)>& sink) const;
+};
+
+
+#endif
@@ -1,11 +1,39 @@
 #ifndef EQUAL_TIME_SOLVER_H_
 #define EQUAL_TIME_SOLVER_H_
 
-#include <tuple>
+#include <cstdint>
+#include <limits>
 #include <utility>
 #include <optional>
+#include <vector>
 #include "parameters/parameters.hpp"
 #include "utils/types.hpp"
+
+
+enum class RootStatus
+{
+    Found,
+    NoBracket,          // No sign change up to the largest bracket tried
+    NonFinite,          // A density or its derivative was NaN or infinite
+    NotConverged,       // The iteration limit was reached
+};
+
+
+struct EqualTime
+{
+    RootStatus status = RootStatus::NoBracket;
+    double t = std::numeric_limits<double>::quiet_NaN();
+    double rho1 = std::numeric_limits<double>::quiet_NaN();
+    double rho2 = std::numeric_limits<double>::quiet_NaN();
+    // Relative quadrature error estimate of rho1 / rho2 at t (see IntegrationUtils::ErrorTally).
+    double densityError = std::numeric_limits<double>::quiet_NaN();
+    // Crossings of the densities in the bracket of t; t is the earliest.
+    std::size_t crossings = 0;
+
+    bool found() const {return status == RootStatus::Found;}
+};
+
+
 /**
  * @class EqualTimeSolver
  * @brief Finds the time when two energy density functions are equal within a specified interval.
@@ -13,6 +41,21 @@
  * This class encapsulates the root-finding logic to determine the time `t` in a given interval
  * [lowerLimit, upperLimit] where two provided energy density functions (rho1 and rho2) are equal,
  * i.e., rho1(t) == rho2(t). The root-finding uses the Toms748 algorithm from Boost.Math.
+ *
+ * The bracket is the decade in which the sign of log rho1 - log rho2 first changes. There the
+ * difference is smooth in log t, so it is sampled at Chebyshev points in log t, doubling their
+ * number until the interpolant reaches proxyTolerance. All crossings of this proxy are found
+ * without further density evaluations; only the earliest is polished with true evaluations.
+ * Crossings that the sign change at the ends of the bracket hides, e.g. a second and third
+ * one, are reported in EqualTime::crossings.
+ *
+ * If the time derivatives of both densities are given, the root is polished with Newton
+ * iterations on log rho1 - log rho2 from the proxy root, safeguarded by bisection whenever a
+ * step would leave the bracket. These converge quadratically and need far fewer evaluations
+ * of the densities, each of which is an integral.
+ *
+ * Failures are reported in the returned status, never thrown; only BudgetExceeded passes
+ * through. A NaN or infinite density ends the search at the first evaluation that sees it.
  */
 
 class EqualTimeSolver
@@ -20,19 +63,48 @@ class EqualTimeSolver
     private:
         EnergyDensity rho1;
         EnergyDensity rho2;
+        EnergyDensityDerivative drho1;
+        EnergyDensityDerivative drho2;
         double lowerLimit;
         std::uintmax_t maxIter = 100;
+        bool nonFinite = false;
+        // Accuracy of the Chebyshev proxy, relative to the largest sampled difference. Its roots
+        // only start the polish, and crossings closer than this cannot be told apart anyway.
+        double proxyTolerance = 1e-4;
+        std::size_t maxProxyOrder = 64;
+
+        // Set by difference when a density was not positive and the logarithms were skipped.
+        bool linearDifference = false;
+
+        struct Bracket
+        {
+            double low;
+            double high;
+            double fa;
+            double fb;
+            bool logarithmic;   // fa and fb are differences of logarithms
+        };
+
+        double difference(double t);
+        std::optional<Bracket> findBracket();
+        // Roots of the Chebyshev proxy of the difference in the bracket, in increasing order;
+        // nullopt where the difference is not logarithmic throughout.
+        std::optional<std::vector<double>> proxyRoots(const Bracket& bracket);
+        // Root of log rho1 - log rho2 in the bracket, polished from guess.
+        std::pair<double, RootStatus> solveInBracket(const Bracket& bracket, double guess);
     public:
         EqualTimeSolver(EnergyDensity _rho1, EnergyDensity _rho2, double _lowerLimit):
         rho1{_rho1}, rho2{_rho2}, lowerLimit{_lowerLimit} {};
+        EqualTimeSolver(EnergyDensity _rho1, EnergyDensityDerivative _drho1,
+                        EnergyDensity _rho2, EnergyDensityDerivative _drho2, double _lowerLimit):
+        rho1{_rho1}, rho2{_rho2}, drho1{_drho1}, drho2{_drho2}, lowerLimit{_lowerLimit} {};
        
         /**
          * @brief Get the time t_eq when rho1 and rho2 are equal i.e., rho1(t)=rho2(t).
-         * 
-         * @return A tuple consisting of (t_eq, rho1(t_eq), rho2(t_eq))
+         *
+         * @return t_eq, rho1(t_eq) and rho2(t_eq), NaN unless the status is Found.
          */
-        std::tuple<double, double, double> getEqualTime();
-        std::optional<std::tuple<double, double, double>> findEqualTime();
+        EqualTime solve();
 
 }; 
 
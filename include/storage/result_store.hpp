@@ -0,0 +1,63 @@
+#ifndef RESULT_STORE_H_
+#define RESULT_STORE_H_
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "parameters/parameters.hpp"
+#include "simulation/simulation.hpp"
+
+/**
+ * @brief Persistent store of finished simulations, keyed by their parameters.
+ *
+ * Records are appended to a single file, each with its length and a checksum, and synced
+ * to disk before store() returns. Opening the store memory-maps the file and indexes every
+ * intact record by a hash of (version, outputs, PrecisionTargets, ModelParameters); a record torn by a crash
+ * is cut off. Lookups read the mapped record directly and compare the full key, so hash
+ * collisions cannot return a wrong point.
+ *
+ * version separates results of different code or tolerance settings; bump codeVersion
+ * whenever a change alters the numbers.
+ */
+class ResultStore
+{
+    private:
+        int fd = -1;
+        const char* mapping = nullptr;
+        std::size_t mappedSize = 0;
+        std::uint64_t version;
+        std::unordered_multimap<std::uint64_t, std::string_view> index;  // Key -> record payload
+        std::deque<std::string> appended;   // Payloads written since opening the store
+        std::mutex mtx;
+
+        void load();
+
+    public:
+        static constexpr std::uint64_t codeVersion = 5;
+
+        explicit ResultStore(const std::string& file, std::uint64_t version = codeVersion);
+        ~ResultStore();
+        ResultStore(const ResultStore&) = delete;
+        ResultStore& operator=(const ResultStore&) = delete;
+
+        /**
+         * @brief Returns the stored results for p computed with the given Outputs and
+         * precision, if any.
+         */
+        std::optional<SimulationResults> lookup(const ModelParameters& p, unsigned outputs,
+                                                const PrecisionTargets& precision = {});
+
+        /**
+         * @brief Appends res durably. Only results with status Ok are stored.
+         */
+        void store(const SimulationResults& res, unsigned outputs, const PrecisionTargets& precision = {});
+
+        std::size_t size();
+};
+
+#endif
@@ -0,0 +1,103 @@
+/* Cooperative per-task time and evaluation budgets. */
+
+#ifndef BUDGET_H_
+#define BUDGET_H_
+
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+
+
+struct TaskBudget
+{
+    double seconds = 0.0;               // Wall time limit per task, 0 = unlimited.
+    std::uint64_t evaluations = 0;      // Limit on checked evaluations per task, 0 = unlimited.
+
+    bool unlimited() const {return seconds <= 0.0 && evaluations == 0;}
+};
+
+
+/**
+ * @brief Thrown by BudgetGuard::check when the active budget is used up.
+ */
+class BudgetExceeded : public std::runtime_error
+{
+    public:
+        explicit BudgetExceeded(const char* what) : std::runtime_error(what) {};
+};
+
+
+/**
+ * @brief Installs a TaskBudget for the calling thread for the lifetime of the guard.
+ *
+ * Hot loops (integrands, solvers, bracketing) call BudgetGuard::check(), which counts one
+ * evaluation and throws BudgetExceeded once the evaluation limit or the deadline is passed.
+ * Without an active guard check() does nothing.
+ */
+class BudgetGuard
+{
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        struct State
+        {
+            Clock::time_point deadline;
+            bool hasDeadline;
+            std::uint64_t maxEvaluations;
+            std::uint64_t count = 0;
+        };
+
+        static inline thread_local State* current = nullptr;
+        State state;
+        State* previous;
+
+        // Reading the clock on every evaluation would cost more than some integrands.
+        static constexpr std::uint64_t clockInterval = 64;
+
+    public:
+        explicit BudgetGuard(const TaskBudget& budget) :
+            state{Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                      std::chrono::duration<double>(budget.seconds)),
+                  budget.seconds > 0.0,
+                  budget.evaluations},
+            previous{current}
+        {
+            current = &state;
+        };
+
+        ~BudgetGuard()
+        {
+            current = previous;
+        };
+
+        BudgetGuard(const BudgetGuard&) = delete;
+        BudgetGuard& operator=(const BudgetGuard&) = delete;
+
+        static void check()
+        {
+            State* s = current;
+            if (!s)
+            {
+                return;
+            }
+
+            ++s->count;
+            if (s->maxEvaluations && s->count > s->maxEvaluations)
+            {
+                throw BudgetExceeded("Evaluation budget exceeded.");
+            }
+            if (s->hasDeadline && s->count % clockInterval == 0 && Clock::now() > s->deadline)
+            {
+                throw BudgetExceeded("Time budget exceeded.");
+            }
+        }
+
+        // Evaluations counted by the active guard of this thread.
+        static std::uint64_t evaluations()
+        {
+            return current ? current->count : 0;
+        }
+};
+
+
+#endif
@@ -0,0 +1,148 @@
+/* Forward-mode automatic differentiation with dual numbers. */
+
+#ifndef DUAL_H_
+#define DUAL_H_
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+
+/**
+ * @brief A value together with its derivatives with respect to N independent variables.
+ *
+ * Arithmetic and the elementary functions below propagate the derivatives by the chain rule,
+ * so templated model code (epoch dilution, alpha) evaluates on Dual just as on double.
+ * Special functions supply their own derivatives through chain().
+ */
+template<std::size_t N>
+struct Dual
+{
+    double value = 0.0;
+    std::array<double, N> grad{};
+
+    Dual() = default;
+    // Constants convert implicitly, with zero derivatives.
+    Dual(double v) : value{v} {};
+
+    /**
+     * @brief The independent variable number i with value v.
+     */
+    static Dual variable(double v, std::size_t i)
+    {
+        Dual x(v);
+        x.grad[i] = 1.0;
+        return x;
+    }
+
+    bool isConstant() const
+    {
+        for (double g : grad)
+        {
+            if (g != 0.0) {return false;}
+        }
+        return true;
+    }
+
+    Dual& operator+=(const Dual& o)
+    {
+        value += o.value;
+        for (std::size_t i = 0; i < N; i++) {grad[i] += o.grad[i];}
+        return *this;
+    }
+
+    Dual& operator-=(const Dual& o)
+    {
+        value -= o.value;
+        for (std::size_t i = 0; i < N; i++) {grad[i] -= o.grad[i];}
+        return *this;
+    }
+
+    Dual& operator*=(const Dual& o)
+    {
+        for (std::size_t i = 0; i < N; i++) {grad[i] = grad[i] * o.value + value * o.grad[i];}
+        value *= o.value;
+        return *this;
+    }
+
+    Dual& operator/=(const Dual& o)
+    {
+        double inv = 1.0 / o.value;
+        value *= inv;
+        for (std::size_t i = 0; i < N; i++) {grad[i] = (grad[i] - value * o.grad[i]) * inv;}
+        return *this;
+    }
+};
+
+
+/**
+ * f(x) given f(x.value) and f'(x.value). Directions x does not depend on stay zero even where
+ * f' is infinite (sqrt at 0), so a singular variable does not spoil the others.
+ */
+template<std::size_t N>
+Dual<N> chain(const Dual<N>& x, double f, double df)
+{
+    Dual<N> y(f);
+    for (std::size_t i = 0; i < N; i++) {y.grad[i] = (x.grad[i] == 0.0) ? 0.0 : df * x.grad[i];}
+    return y;
+}
+
+template<std::size_t N> Dual<N> operator+(Dual<N> a, const Dual<N>& b) {return a += b;}
+template<std::size_t N> Dual<N> operator-(Dual<N> a, const Dual<N>& b) {return a -= b;}
+template<std::size_t N> Dual<N> operator*(Dual<N> a, const Dual<N>& b) {return a *= b;}
+template<std::size_t N> Dual<N> operator/(Dual<N> a, const Dual<N>& b) {return a /= b;}
+template<std::size_t N> Dual<N> operator+(Dual<N> a, double b) {return a += Dual<N>(b);}
+template<std::size_t N> Dual<N> operator-(Dual<N> a, double b) {return a -= Dual<N>(b);}
+template<std::size_t N> Dual<N> operator*(Dual<N> a, double b) {return a *= Dual<N>(b);}
+template<std::size_t N> Dual<N> operator/(Dual<N> a, double b) {return a /= Dual<N>(b);}
+template<std::size_t N> Dual<N> operator+(double a, const Dual<N>& b) {return Dual<N>(a) += b;}
+template<std::size_t N> Dual<N> operator-(double a, const Dual<N>& b) {return Dual<N>(a) -= b;}
+template<std::size_t N> Dual<N> operator*(double a, const Dual<N>& b) {return Dual<N>(a) *= b;}
+template<std::size_t N> Dual<N> operator/(double a, const Dual<N>& b) {return Dual<N>(a) /= b;}
+template<std::size_t N> Dual<N> operator-(const Dual<N>& a) {return chain(a, -a.value, -1.0);}
+
+template<std::size_t N> bool operator<(const Dual<N>& a, const Dual<N>& b) {return a.value < b.value;}
+template<std::size_t N> bool operator>(const Dual<N>& a, const Dual<N>& b) {return a.value > b.value;}
+template<std::size_t N> bool operator==(const Dual<N>& a, const Dual<N>& b) {return a.value == b.value;}
+
+template<std::size_t N>
+Dual<N> exp(const Dual<N>& x)
+{
+    double e = std::exp(x.value);
+    return chain(x, e, e);
+}
+
+template<std::size_t N>
+Dual<N> log(const Dual<N>& x)
+{
+    return chain(x, std::log(x.value), 1.0 / x.value);
+}
+
+template<std::size_t N>
+Dual<N> sqrt(const Dual<N>& x)
+{
+    double s = std::sqrt(x.value);
+    return chain(x, s, 0.5 / s);
+}
+
+template<std::size_t N>
+Dual<N> cbrt(const Dual<N>& x)
+{
+    double c = std::cbrt(x.value);
+    return chain(x, c, c / (3.0 * x.value));
+}
+
+template<std::size_t N>
+Dual<N> pow(const Dual<N>& x, double e)
+{
+    double p = std::pow(x.value, e);
+    return chain(x, p, e * p / x.value);
+}
+
+template<std::size_t N>
+Dual<N> abs(const Dual<N>& x)
+{
+    return x.value < 0 ? -x : x;
+}
+
+
+#endif
@@ -3,20 +3,490 @@
 #ifndef INTEGRATION_H_
 #define INTEGRATION_H_
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <boost/math/quadrature/gauss.hpp>
 #include <boost/math/quadrature/gauss_kronrod.hpp>
+#include "utils/budget.hpp"
 
 using boost::math::quadrature::gauss_kronrod;
 
 namespace IntegrationUtils{
 
+/**
+ * @brief Error allowed for an integral, relative to its value.
+ *
+ * Budgets are derived from the precision asked of the final results (see PrecisionTargets in
+ * simulation/simulation.hpp), so every quadrature is resolved only as finely as needed.
+ */
+struct ErrorBudget
+{
+    double relative = 1e-9;
+    unsigned maxDepth = 6;          // Bisections of the interval at most
+
+    // Budget of each of two contributions that must add up to at most this one.
+    ErrorBudget half() const {return {relative / 2, maxDepth};}
+
+    bool operator==(const ErrorBudget&) const = default;
+};
+
+
+/**
+ * @brief Collects the relative error estimates of the integrals evaluated on the calling
+ * thread for the lifetime of the tally. Without an active tally nothing is recorded.
+ *
+ * The estimates of integrate include the errors of integrals nested in its integrand, so a
+ * tally around the evaluation of a density yields the error of that density. The largest
+ * recorded estimate also bounds the relative error of a sum of positive integrals.
+ */
+class ErrorTally
+{
+    private:
+        static inline thread_local ErrorTally* current = nullptr;
+        ErrorTally* previous;
+        double largestError = 0.0;
+
+    public:
+        ErrorTally() : previous{current} {current = this;};
+        ~ErrorTally() {current = previous;};
+        ErrorTally(const ErrorTally&) = delete;
+        ErrorTally& operator=(const ErrorTally&) = delete;
+
+        // Also for values taken from a cache instead of being integrated again.
+        static void record(double relative)
+        {
+            if (current)
+            {
+                current->largestError = std::max(current->largestError, relative);
+            }
+        }
+
+        double largest() const {return largestError;}
+};
+
+
+namespace detail{
+
+/**
+ * Error of a Gauss-Kronrod result as QUADPACK estimates it. The Kronrod-Gauss difference
+ * measures the error of the embedded Gauss rule rather than the far smaller one of the Kronrod
+ * rule, so it is scaled as resasc min(1, (200 difference / resasc)^1.5), with resasc the
+ * integral of |f - mean of f| over the panel, and kept above the rounding error
+ * 50 eps resabs, with resabs the integral of |f|.
+ */
+template<typename T>
+T kronrodError(T difference, T resasc, T resabs)
+{
+    using std::max;
+    using std::min;
+    using std::pow;
+    const T epsilon = std::numeric_limits<T>::epsilon();
+    T error = difference;
+    if (resasc != 0 && error != 0)
+    {
+        error = resasc * min(T(1), pow(200 * error / resasc, T(1.5)));
+    }
+    if (resabs > std::numeric_limits<T>::min() / (50 * epsilon))
+    {
+        error = max(50 * epsilon * resabs, error);
+    }
+    return error;
+}
+
+/**
+ * One 31-point Gauss-Kronrod panel over [a, b] applied to every component of f.
+ * The error estimate of each component (kronrodError) is written to error.
+ */
+template<std::size_t N, typename F, typename T>
+std::array<T, N> gaussKronrodPanel(F& f, T a, T b, std::array<T, N>& error)
+{
+    using std::abs;
+    using Kronrod = gauss_kronrod<T, 31>;
+    using Gauss = boost::math::quadrature::gauss<T, 15>;
+    constexpr std::size_t abscissae = 16;       // The centre and the 15 positive nodes
+
+    const T mid = (a + b) / 2;
+    const T half = (b - a) / 2;
+
+    // f at the centre, then at mid - x and mid + x for every positive node x.
+    std::array<std::array<T, N>, 2 * abscissae - 1> values;
+    values[0] = f(mid);
+    for (std::size_t j = 1; j < abscissae; j++)
+    {
+        T x = half * Kronrod::abscissa()[j];
+        values[2 * j - 1] = f(mid - x);
+        values[2 * j] = f(mid + x);
+    }
+
+    std::array<T, N> result;
+    for (std::size_t i = 0; i < N; i++)
+    {
+        // Sums over [-1, 1], whose weights add up to 2.
+        T kronrod = values[0][i] * Kronrod::weights()[0];
+        T gauss = values[0][i] * Gauss::weights()[0];
+        T absolute = abs(values[0][i]) * Kronrod::weights()[0];
+        for (std::size_t j = 1; j < abscissae; j++)
+        {
+            // Every second Kronrod node is shared with the embedded Gauss rule.
+            T pair = values[2 * j - 1][i] + values[2 * j][i];
+            kronrod += pair * Kronrod::weights()[j];
+            gauss += (j % 2 == 0) ? pair * Gauss::weights()[j / 2] : T(0);
+            absolute += (abs(values[2 * j - 1][i]) + abs(values[2 * j][i])) * Kronrod::weights()[j];
+        }
+        T mean = kronrod / 2;
+        T deviation = abs(values[0][i] - mean) * Kronrod::weights()[0];
+        for (std::size_t j = 1; j < abscissae; j++)
+        {
+            deviation += (abs(values[2 * j - 1][i] - mean) + abs(values[2 * j][i] - mean)) * Kronrod::weights()[j];
+        }
+
+        result[i] = kronrod * half;
+        error[i] = kronrodError(abs((kronrod - gauss) * half), deviation * abs(half), absolute * abs(half));
+    }
+    return result;
+}
+
+/**
+ * Integral over [a, b] of the N components of f, given their panel. Only the leading L
+ * components decide whether a panel is accepted, each against its budget in absTol; the others
+ * follow the same bisections. Each half of a rejected panel gets half of the budgets. The
+ * panel errors of all components are added to error. A leading component that is not finite
+ * makes the integral and its error NaN at once.
+ */
+template<std::size_t L, std::size_t N, typename F, typename T>
+std::array<T, N> integrateAdaptive(F& f, T a, T b, const std::array<T, N>& panel,
+                                   const std::array<T, N>& panelError, std::array<T, L> absTol,
+                                   unsigned depth, std::array<T, N>& error)
+{
+    using std::isfinite;
+    bool accepted = true;
+    for (std::size_t i = 0; i < L; i++)
+    {
+        if (!isfinite(panel[i]) || !isfinite(panelError[i]))
+        {
+            // No bisection resolves a NaN or infinite integrand.
+            error.fill(std::numeric_limits<T>::quiet_NaN());
+            std::array<T, N> nan;
+            nan.fill(std::numeric_limits<T>::quiet_NaN());
+            return nan;
+        }
+        accepted = accepted && panelError[i] <= absTol[i];
+    }
+    if (accepted || depth == 0)
+    {
+        for (std::size_t i = 0; i < N; i++)
+        {
+            error[i] += panelError[i];
+        }
+        return panel;
+    }
+
+    for (T& tol : absTol)
+    {
+        tol /= 2;
+    }
+    T mid = (a + b) / 2;
+    std::array<T, N> sum{};
+    for (auto [low, high] : {std::pair{a, mid}, std::pair{mid, b}})
+    {
+        std::array<T, N> halfError;
+        std::array<T, N> half = gaussKronrodPanel<N>(f, low, high, halfError);
+        half = integrateAdaptive<L>(f, low, high, half, halfError, absTol, depth - 1, error);
+        for (std::size_t i = 0; i < N; i++)
+        {
+            sum[i] += half[i];
+        }
+    }
+    return sum;
+}
+
+template<std::size_t N, typename F, typename T>
+std::array<T, N> integrateJointlyRecursive(F& f, T a, T b, double tol, unsigned depth,
+                                           std::array<T, N>& error)
+{
+    std::array<T, N> panelError;
+    std::array<T, N> result = gaussKronrodPanel<N>(f, a, b, panelError);
+
+    using std::isfinite;
+    bool converged = true;
+    bool finite = true;         // Bisection does not resolve a NaN or infinite component
+    for (std::size_t i = 0; i < N; i++)
+    {
+        converged = converged && panelError[i] <= tol * std::abs(result[i]);
+        finite = finite && isfinite(result[i]) && isfinite(panelError[i]);
+    }
+
+    if (converged || depth == 0 || !finite)
+    {
+        for (std::size_t i = 0; i < N; i++)
+        {
+            error[i] += panelError[i];
+        }
+        return result;
+    }
+
+    T mid = (a + b) / 2;
+    std::array<T, N> left = integrateJointlyRecursive<N>(f, a, mid, tol, depth - 1, error);
+    std::array<T, N> right = integrateJointlyRecursive<N>(f, mid, b, tol, depth - 1, error);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        result[i] = left[i] + right[i];
+    }
+    return result;
+}
+
+};
+
+
+/**
+ * @brief Integrates f over [lower, upper] to within the relative error budget.
+ *
+ * Adaptive 31-point Gauss-Kronrod quadrature. The estimate includes the errors of integrals
+ * nested in f. It is recorded in the active ErrorTally and, if error is given, returned there.
+ *
+ * Over more than two decades the last two are integrated on a linear scale, where the nodes
+ * resolve the growing integrands of this model, and everything below on a log t scale.
+ * There features like the creation peak at t ~ 1/m fall on nodes, whereas on one linear
+ * panel all nodes can miss them, and then the Gauss and Kronrod results agree on the wrong
+ * value. Both parts share the budget in absolute terms, so the early part, usually small,
+ * is resolved only to what it contributes.
+ */
 template<typename F, typename T>
-T integrate(F&& f, T lower, T upper, double tol = 1e-15)
+T integrate(F&& f, T lower, T upper, const ErrorBudget& budget = {}, T* error = nullptr)
+{
+    using std::abs;
+    using std::exp;
+    using std::log;
+
+    // The value and the error the integrals nested in it contribute. Every integrand
+    // evaluation counts against the budget of the running task.
+    auto checked = [&f](T t) -> std::array<T, 2>
+    {
+        BudgetGuard::check();
+        ErrorTally nested;
+        T value = f(t);
+        return {value, abs(value) * T(nested.largest())};
+    };
+    auto logChecked = [&checked](T x) -> std::array<T, 2>
+    {
+        T t = exp(x);
+        auto [value, nestedError] = checked(t);
+        return {value * t, nestedError * t};
+    };
+
+    const bool split = lower > 0 && upper > 100 * lower;
+    const T linearStart = split ? upper / 100 : lower;
+    std::array<T, 2> linearError;
+    std::array<T, 2> linear = detail::gaussKronrodPanel<2>(checked, linearStart, upper, linearError);
+    std::array<T, 2> early{};
+    std::array<T, 2> earlyError{};
+    if (split)
+    {
+        early = detail::gaussKronrodPanel<2>(logChecked, log(lower), log(linearStart), earlyError);
+    }
+
+    using std::isfinite;
+    T absTol = budget.relative * abs(linear[0] + early[0]);
+    if (!isfinite(absTol))
+    {
+        // Either part is not finite; bisecting the other would not change the result.
+        if (error)
+        {
+            *error = std::numeric_limits<T>::quiet_NaN();
+        }
+        return std::numeric_limits<T>::quiet_NaN();
+    }
+    // The error of the nested integrals, in the second component, is not reduced by any
+    // bisection, so only the first decides whether a panel is accepted.
+    std::array<T, 2> errors{};
+    std::array<T, 2> sum = detail::integrateAdaptive<1>(checked, linearStart, upper, linear, linearError,
+                                                        {split ? absTol / 2 : absTol}, budget.maxDepth, errors);
+    if (split)
+    {
+        std::array<T, 2> earlySum = detail::integrateAdaptive<1>(logChecked, log(lower), log(linearStart),
+                                                                 early, earlyError, {absTol / 2},
+                                                                 budget.maxDepth, errors);
+        sum[0] += earlySum[0];
+        sum[1] += earlySum[1];
+    }
+    T result = sum[0];
+    T errorEstimate = errors[0] + abs(sum[1]);
+    if (result != 0)
+    {
+        ErrorTally::record(double(errorEstimate / abs(result)));
+    }
+    if (error)
+    {
+        *error = errorEstimate;
+    }
+    return result;
+}
+
+
+/**
+ * @brief Integrates the N components of f over [lower, upper] on one adaptive grid, which
+ * resolves the leading L components to within the relative error budget.
+ *
+ * The bisection of integrate, for integrands whose trailing components follow the leading
+ * ones, like the derivatives of the leading values in the sensitivity analysis. The relative
+ * estimates of the leading components are recorded in the active ErrorTally.
+ *
+ * @param error If given, receives the error estimate of each component.
+ */
+template<std::size_t L, std::size_t N, typename F, typename T>
+std::array<T, N> integrateLeading(F&& f, T lower, T upper, const ErrorBudget& budget = {},
+                                  std::array<T, N>* error = nullptr)
+{
+    static_assert(L <= N, "The leading components are among the N components of f");
+    using std::abs;
+
+    auto checked = [&f](T t)
+    {
+        BudgetGuard::check();
+        return f(t);
+    };
+    std::array<T, N> panelError;
+    std::array<T, N> panel = detail::gaussKronrodPanel<N>(checked, lower, upper, panelError);
+    std::array<T, L> absTol;
+    for (std::size_t i = 0; i < L; i++)
+    {
+        absTol[i] = budget.relative * abs(panel[i]);
+    }
+
+    std::array<T, N> errorEstimate{};
+    std::array<T, N> result = detail::integrateAdaptive<L>(checked, lower, upper, panel, panelError,
+                                                           absTol, budget.maxDepth, errorEstimate);
+    for (std::size_t i = 0; i < L; i++)
+    {
+        if (result[i] != 0)
+        {
+            ErrorTally::record(double(errorEstimate[i] / abs(result[i])));
+        }
+    }
+    if (error)
+    {
+        *error = errorEstimate;
+    }
+    return result;
+}
+
+
+/**
+ * @brief Integrates several integrands that share their expensive part in a single pass.
+ *
+ * f returns a std::array with one value per integrand. Each node is evaluated only once and
+ * the interval is bisected until the Gauss-Kronrod error estimate of every component is
+ * below tol relative to its value, or maxDepth is reached.
+ *
+ * @param error If given, receives the accumulated error estimate of each component. The
+ * relative estimates are also recorded in the active ErrorTally.
+ */
+template<std::size_t N, typename F, typename T>
+std::array<T, N> integrateJointly(F&& f, T lower, T upper, double tol = 1e-10,
+                                  unsigned maxDepth = 15, std::array<T, N>* error = nullptr)
+{
+    std::array<T, N> errorEstimate{};
+    auto checked = [&f](T t)
+    {
+        BudgetGuard::check();
+        return f(t);
+    };
+    auto result = detail::integrateJointlyRecursive<N>(checked, lower, upper, tol, maxDepth, errorEstimate);
+    for (std::size_t i = 0; i < N; i++)
+    {
+        if (result[i] != 0)
+        {
+            ErrorTally::record(double(errorEstimate[i] / std::abs(result[i])));
+        }
+    }
+    if (error)
+    {
+        *error = errorEstimate;
+    }
+    return result;
+}
+
+
+/**
+ * @brief The N + 1 Chebyshev-Lobatto points of [a, b] in increasing order.
+ */
+template<std::size_t N>
+std::array<double, N + 1> chebyshevNodes(double a, double b)
 {
-    thread_local gauss_kronrod<T, 31> integrator;
-    return integrator.integrate(std::forward<F>(f), lower, upper, tol);
+    std::array<double, N + 1> nodes;
+    for (std::size_t j = 0; j <= N; j++)
+    {
+        nodes[j] = (a + b) / 2 - (b - a) / 2 * std::cos(std::numbers::pi * j / N);
+    }
+    // Exact end points, so that consecutive panels share them.
+    nodes.front() = a;
+    nodes.back() = b;
+    return nodes;
+}
+
+
+/**
+ * @brief Integrals from a to every node, given the values of f at chebyshevNodes<N>(a, b).
+ *
+ * Interpolates f by a Chebyshev series and integrates the series (Clenshaw-Curtis), so that
+ * one set of N + 1 values yields the running integral at all nodes with spectral accuracy for
+ * smooth f. The last entry is the integral over [a, b].
+ */
+template<std::size_t N>
+std::array<double, N + 1> cumulativeChebyshev(const std::array<double, N + 1>& values, double a, double b)
+{
+    // cos(pi m / N) for m = 0 ... 2N - 1; cos(pi i k / N) is the entry (i k) mod 2N.
+    std::array<double, 2 * N> cosines;
+    for (std::size_t m = 0; m < 2 * N; m++)
+    {
+        cosines[m] = std::cos(std::numbers::pi * m / N);
+    }
+
+    // Node j is x = cos(pi (N - j) / N) on [-1, 1]. Coefficients of f = sum a_k T_k.
+    std::array<double, N + 2> coeffs{};
+    for (std::size_t k = 0; k <= N; k++)
+    {
+        double sum = 0.0;
+        for (std::size_t i = 0; i <= N; i++)
+        {
+            double term = values[N - i] * cosines[(i * k) % (2 * N)];
+            sum += (i == 0 || i == N) ? term / 2 : term;
+        }
+        coeffs[k] = (k == 0 || k == N) ? sum / N : 2.0 * sum / N;
+    }
+
+    // Antiderivative F = sum b_k T_k with F(-1) = 0.
+    std::array<double, N + 2> integral{};
+    integral[1] = coeffs[0] - coeffs[2] / 2;
+    for (std::size_t k = 2; k <= N + 1; k++)
+    {
+        integral[k] = (coeffs[k - 1] - coeffs[k + 1 <= N ? k + 1 : N + 1]) / (2.0 * k);
+    }
+    for (std::size_t k = 1; k <= N + 1; k++)
+    {
+        integral[0] -= (k % 2 == 0) ? integral[k] : -integral[k];
+    }
+
+    std::array<double, N + 1> result;
+    for (std::size_t j = 0; j <= N; j++)
+    {
+        double sum = 0.0;
+        for (std::size_t k = 0; k <= N + 1; k++)
+        {
+            sum += integral[k] * cosines[(k * (N - j)) % (2 * N)];
+        }
+        result[j] = sum * (b - a) / 2;
+    }
+    result[0] = 0.0;
+    return result;
 }
 
 };
 
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,92 @@
+/* Memory resources for simulation-scoped allocations. */
+
+#ifndef MEMORY_H_
+#define MEMORY_H_
+
+#include <array>
+#include <cstddef>
+#include <memory_resource>
+
+
+/**
+ * @brief Forwards to an upstream resource and counts the allocations passing through.
+ */
+class CountingResource : public std::pmr::memory_resource
+{
+    private:
+        std::pmr::memory_resource* upstream;
+        std::size_t allocations = 0;
+        std::size_t bytes = 0;
+
+        void* do_allocate(std::size_t size, std::size_t alignment) override
+        {
+            allocations++;
+            bytes += size;
+            return upstream->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* ptr, std::size_t size, std::size_t alignment) override
+        {
+            upstream->deallocate(ptr, size, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    public:
+        explicit CountingResource(std::pmr::memory_resource* upstream_ = std::pmr::get_default_resource()) :
+            upstream{upstream_} {};
+
+        std::size_t getAllocations() const {return allocations;}
+        std::size_t getBytes() const {return bytes;}
+        void resetCounters() {allocations = 0; bytes = 0;}
+};
+
+
+/**
+ * @brief Per-worker memory for a reusable simulation context.
+ *
+ * Blocks come from a local buffer via a monotonic resource, overflowing into larger
+ * upstream chunks. An unsynchronized pool on top recycles freed blocks, so a context that
+ * is rebound between tasks reuses its memory instead of going to the global allocator.
+ * The arena is not thread safe; each worker owns its own.
+ */
+class SimulationArena
+{
+    private:
+        static constexpr std::size_t initialSize = 64 * 1024;
+
+        alignas(std::max_align_t) std::array<std::byte, initialSize> buffer;
+        std::pmr::monotonic_buffer_resource arena{buffer.data(), buffer.size()};
+        std::pmr::unsynchronized_pool_resource pool{&arena};
+        CountingResource counter{&pool};
+
+    public:
+        SimulationArena() = default;
+        SimulationArena(const SimulationArena&) = delete;
+        SimulationArena& operator=(const SimulationArena&) = delete;
+
+        std::pmr::memory_resource* resource() {return &counter;}
+
+        // Starts counting the allocations of a new task.
+        void resetCounters()
+        {
+            counter.resetCounters();
+        }
+
+        // Releases all memory at once. Nothing allocated from resource() may be in use.
+        void release()
+        {
+            pool.release();
+            arena.release();
+            counter.resetCounters();
+        }
+
+        std::size_t getAllocations() const {return counter.getAllocations();}
+        std::size_t getBytes() const {return counter.getBytes();}
+};
+
+
+#endif
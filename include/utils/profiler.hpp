@@ -0,0 +1,116 @@
+/* Per-phase timing and hardware performance counters. */
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+
+// Regions of a simulation that are profiled separately.
+enum class ProfilePhase
+{
+    Stiff,          // Simulation::runStiffPhase
+    Matter,         // Simulation::runMatterPhase
+    Radiation,      // Simulation::runRadiationPhase
+    Reheating,      // Simulation::getReheatingTemperatureAndTime
+    Creation,       // PhiCreationRate kernel
+    Decay,          // ChiDecayRate Bessel kernel
+    Count
+};
+
+const char* phaseName(ProfilePhase phase);
+
+
+struct PhaseCounters
+{
+    std::uint64_t calls = 0;
+    std::uint64_t nanoseconds = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t instructions = 0;
+    std::uint64_t cacheMisses = 0;
+    std::uint64_t branchMisses = 0;
+};
+
+
+struct RunProfile
+{
+    bool hardwareCounters = false;      // False if only the times were measured
+    std::array<PhaseCounters, static_cast<std::size_t>(ProfilePhase::Count)> phases{};
+
+    PhaseCounters& operator[](ProfilePhase phase) {return phases[static_cast<std::size_t>(phase)];}
+    const PhaseCounters& operator[](ProfilePhase phase) const {return phases[static_cast<std::size_t>(phase)];}
+};
+
+
+/**
+ * @brief Collects a RunProfile for the calling thread for the lifetime of the profiler.
+ *
+ * ProfileScope objects placed in the simulation add their region to the active profile.
+ * Hardware counters (cycles, instructions, cache misses, branch misses of user space) are
+ * read with perf_event_open from a counter group opened once per thread. Where the kernel
+ * does not allow it (perf_event_paranoid, containers, non-Linux), only times are recorded.
+ *
+ * Counts are inclusive: the kernel regions are also part of the phase that calls them. Each
+ * scope costs a clock read and one read() system call, which is significant next to a
+ * single kernel evaluation; compare profiles with each other, not with unprofiled runs.
+ * Without an active profiler a scope does nothing.
+ */
+class Profiler
+{
+    private:
+        static inline thread_local RunProfile* current = nullptr;
+        RunProfile* previous;
+
+        friend class ProfileScope;
+
+    public:
+        explicit Profiler(RunProfile& profile);
+        ~Profiler();
+        Profiler(const Profiler&) = delete;
+        Profiler& operator=(const Profiler&) = delete;
+
+        // Whether hardware counters can be read on this thread.
+        static bool countersAvailable();
+};
+
+
+/**
+ * @brief Adds the time and counters between construction and destruction to a phase.
+ */
+class ProfileScope
+{
+    private:
+        RunProfile* profile;
+        ProfilePhase phase;
+        std::chrono::steady_clock::time_point start;
+        std::array<std::uint64_t, 4> startCounts;
+
+        void begin();
+        void end();
+
+    public:
+        explicit ProfileScope(ProfilePhase phase_) : profile{Profiler::current}, phase{phase_}
+        {
+            if (profile)
+            {
+                begin();
+            }
+        };
+
+        ~ProfileScope()
+        {
+            if (profile)
+            {
+                end();
+            }
+        };
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+
+#endif
@@ -8,5 +8,17 @@
 #include "parameters/parameters.hpp"
 
 using EnergyDensity = std::function<double(double t)>;
+// d rho / dt at t, given rho(t) so that the density is not evaluated twice.
+using EnergyDensityDerivative = std::function<double(double t, double rho)>;
+
+// Extended precision for the few cancellation-prone evaluations. __float128 when the
+// build found libquadmath, otherwise the (slower) software quad type.
+#ifdef REHEATING_USE_FLOAT128
+#include <boost/multiprecision/float128.hpp>
+using ExtendedPrecision = boost::multiprecision::float128;
+#else
+#include <boost/multiprecision/cpp_bin_float.hpp>
+using ExtendedPrecision = boost::multiprecision::cpp_bin_float_quad;
+#endif
 
 #endif
\ No newline at end of file
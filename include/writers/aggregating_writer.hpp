@@ -0,0 +1,159 @@
+#ifndef AGGREGATING_WRITER_H_
+#define AGGREGATING_WRITER_H_
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "writers/results_writer.hpp"
+
+using namespace std::filesystem;
+
+
+/**
+ * Model parameters that AggregatingWriter can group results by. Results with equal values of
+ * all selected parameters form one group.
+ */
+namespace GroupBy
+{
+    enum : unsigned
+    {
+        M      = 1u << 0,
+        Lambda = 1u << 1,
+        B      = 1u << 2,
+        Xi     = 1u << 3,
+        None   = 0,
+    };
+}
+
+
+/**
+ * @brief Quantile of a stream in constant memory, with the P^2 algorithm of Jain and
+ * Chlamtac: five markers whose heights are adjusted by piecewise-parabolic interpolation.
+ *
+ * Exact for up to five values.
+ */
+class StreamingQuantile
+{
+    private:
+        double probability;
+        std::size_t count = 0;
+        std::array<double, 5> heights{};
+        std::array<double, 5> positions{};
+        std::array<double, 5> desired{};
+        std::array<double, 5> increments{};
+
+    public:
+        explicit StreamingQuantile(double probability_) : probability{probability_} {};
+        void add(double x);
+        // NaN before the first value.
+        double value() const;
+};
+
+
+/**
+ * @brief One statistic of a quantity over the results of each group.
+ *
+ * NaN values of the quantity (notComputed, failed runs) are skipped. A fraction, such as
+ * that of toMatter results, is the Mean of a quantity that is 0 or 1.
+ */
+struct Aggregation
+{
+    using Quantity = std::function<double(const SimulationResults&)>;
+
+    enum class Kind
+    {
+        Count,          // Values that are not NaN
+        Mean,
+        Min,
+        Max,
+        ArgMin,         // argument at the minimum of quantity
+        ArgMax,         // argument at the maximum of quantity
+        Quantile,       // Streaming estimate, see StreamingQuantile
+        Histogram,      // Counts in bins over [lower, upper), and below and above
+    };
+
+    Kind kind;
+    std::string name;               // Column name, prefix of the bin columns of a Histogram
+    Quantity quantity;
+    Quantity argument = {};         // ArgMin and ArgMax
+    double probability = 0.5;       // Quantile
+    double lower = 0.0;             // Histogram
+    double upper = 1.0;
+    std::size_t bins = 10;
+    bool logarithmic = false;       // Bins of equal width in log of the quantity
+};
+
+
+/**
+ * @brief Summarizes results in the process instead of writing a row per result.
+ *
+ * Every result updates the Aggregations of its group in constant memory, so that sweeps feeding
+ * summary plots need not keep their row dump. The table, one row per group in increasing
+ * order of the grouping parameters, replaces the file in the "results" directory of CSVWriter
+ * on emit() and every emitInterval results, so an interrupted sweep leaves its latest
+ * summary. Call emit() once all results are written; the destructor does not.
+ *
+ * Every result is forwarded to the wrapped writer as well, if there is one.
+ */
+class AggregatingWriter : public ResultsWriter
+{
+    private:
+        struct Accumulator
+        {
+            std::size_t count = 0;
+            double sum = 0.0;
+            double extremum;
+            double argument;
+            std::vector<StreamingQuantile> quantile;    // One for a Quantile, empty otherwise
+            std::vector<std::size_t> histogram;         // Below, the bins, above
+        };
+
+        struct Group
+        {
+            std::size_t results = 0;
+            std::vector<Accumulator> accumulators;      // One per aggregation
+        };
+
+        unsigned groupBy;
+        std::vector<Aggregation> aggregations;
+        std::unique_ptr<ResultsWriter> forward;
+        std::size_t emitInterval;
+        std::size_t sinceEmit = 0;
+        std::map<std::array<double, 4>, Group> groups;     // Key: (m, lambda, b, xi), 0 if not grouped by
+        std::mutex mtx;
+        std::string filename;
+        path outputDir = current_path().parent_path() / "results";
+        path outputFile = outputDir / filename;
+
+        Group newGroup() const;
+        void add(Accumulator& acc, const Aggregation& aggregation, const SimulationResults& res) const;
+        std::string tableLocked() const;
+        void emitLocked();
+
+    public:
+        /**
+         * @param groupBy Bitwise or of GroupBy flags.
+         * @param emitInterval Results between emissions; 0 to emit only on emit().
+         * @throws std::invalid_argument for an Aggregation without quantity, an ArgMin or
+         * ArgMax without argument, a Histogram without bins or range, or a Quantile
+         * probability outside (0, 1).
+         */
+        AggregatingWriter(unsigned groupBy, std::vector<Aggregation> aggregations,
+                          std::unique_ptr<ResultsWriter> forward = nullptr,
+                          std::size_t emitInterval = 0, std::string file = "aggregates.csv");
+        void write(const SimulationResults& res) override;
+
+        // Current summary as CSV text, with a header line.
+        std::string table();
+        // Writes the current summary to the file, replacing the previous one.
+        void emit();
+};
+
+
+#endif
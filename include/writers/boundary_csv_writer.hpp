@@ -0,0 +1,30 @@
+#ifndef BOUNDARY_CSV_WRITER_H_
+#define BOUNDARY_CSV_WRITER_H_
+
+#include <fstream>
+#include <string>
+#include <filesystem>
+#include "simulation/phase_boundary_tracer.hpp"
+
+using namespace std::filesystem;
+
+/**
+ * @brief Write a traced phase boundary to a CSV file.
+ *
+ * Outputs BoundaryPoints to a CSV file inside the same "results" directory as CSVWriter.
+ */
+class BoundaryCSVWriter
+{
+    private:
+        std::ofstream fs;
+        std::string filename;
+        path outputDir = current_path().parent_path() / "results";
+        path outputFile = outputDir / filename;
+
+    public:
+        explicit BoundaryCSVWriter(std::string file = "boundary.csv");
+        void write(const BoundaryPoint& point);
+};
+
+
+#endif
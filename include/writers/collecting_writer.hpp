@@ -0,0 +1,31 @@
+#ifndef COLLECTING_WRITER_H_
+#define COLLECTING_WRITER_H_
+
+#include <mutex>
+#include <vector>
+#include "writers/results_writer.hpp"
+
+/**
+ * @brief Keeps simulation results in memory.
+ *
+ * Used by drivers that decide on further simulations based on earlier results.
+ * Optionally forwards every result to another writer (not owned) as well.
+ */
+class CollectingWriter : public ResultsWriter
+{
+    private:
+        std::vector<SimulationResults> results;
+        std::mutex mtx;
+        ResultsWriter* forward;
+
+    public:
+        explicit CollectingWriter(ResultsWriter* forward_ = nullptr) : forward{forward_} {};
+        void write(const SimulationResults& res) override;
+
+        /**
+         * @brief Returns the results collected so far and clears the internal buffer.
+         */
+        std::vector<SimulationResults> take();
+};
+
+#endif
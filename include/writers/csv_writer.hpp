@@ -25,11 +25,13 @@ class CSVWriter : public ResultsWriter
         path outputDir = current_path().parent_path() / "results";
         path outputFile = outputDir / filename;
 
-        static std::string toCSVRow(const SimulationResults& res);
-
     public:
         explicit CSVWriter(std::string file = "results.csv");
         void write(const SimulationResults& res) override;
+
+        // Column names and row format, shared with other text outputs.
+        static std::string header();
+        static std::string toCSVRow(const SimulationResults& res);
 };
 
 
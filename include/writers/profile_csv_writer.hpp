@@ -0,0 +1,36 @@
+#ifndef PROFILE_CSV_WRITER_H_
+#define PROFILE_CSV_WRITER_H_
+
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <string>
+#include <filesystem>
+#include "writers/results_writer.hpp"
+
+using namespace std::filesystem;
+
+/**
+ * @brief Write the RunProfile of every result to a CSV file.
+ *
+ * One row per profiled run with the calls, seconds and hardware counters of every
+ * ProfilePhase, in the same "results" directory as CSVWriter. Every result is forwarded to
+ * the wrapped writer as well; results without a profile are only forwarded.
+ */
+class ProfileCSVWriter : public ResultsWriter
+{
+    private:
+        std::ofstream fs;
+        std::mutex mtx;
+        std::unique_ptr<ResultsWriter> forward;
+        std::string filename;
+        path outputDir = current_path().parent_path() / "results";
+        path outputFile = outputDir / filename;
+
+    public:
+        explicit ProfileCSVWriter(std::unique_ptr<ResultsWriter> forward, std::string file = "profile.csv");
+        void write(const SimulationResults& res) override;
+};
+
+
+#endif
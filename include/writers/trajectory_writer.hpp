@@ -0,0 +1,49 @@
+#ifndef TRAJECTORY_WRITER_H_
+#define TRAJECTORY_WRITER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <filesystem>
+#include "simulation/trajectory.hpp"
+
+using namespace std::filesystem;
+
+/**
+ * @brief Write trajectories to a compact binary file.
+ *
+ * Outputs to a file inside the same "results" directory as CSVWriter. The file holds any
+ * number of trajectories, each a header followed by its points, all little-endian as written
+ * by the host:
+ *
+ *   header: char[8] "RHTRAJ1\0", double t0, m, lambda, b, xi, G_N
+ *   point:  uint8 epoch (Epoch as integer), double t, rho_stiff, rho_phi, rho_chi
+ *   end:    uint8 0xFF
+ *
+ * Points are written as they arrive, so a trajectory can be read while it is traced.
+ */
+class TrajectoryWriter
+{
+    private:
+        std::ofstream fs;
+        std::string filename;
+        path outputDir = current_path().parent_path() / "results";
+        path outputFile = outputDir / filename;
+
+        template<typename T>
+        void put(const T& value)
+        {
+            fs.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+    public:
+        static constexpr std::uint8_t endMarker = 0xFF;
+
+        explicit TrajectoryWriter(std::string file = "trajectories.bin");
+        void begin(const ModelParameters& p);
+        void write(const TrajectoryPoint& point);
+        void end();
+};
+
+
+#endif
@@ -19,78 +19,350 @@
  * manager, and coordinates multi-threaded simulation runs. The results are written to a CSV file.
  * The filename can be set in the CSWWriter constructor. You can change the parameter grid in the
  * code below.
+ *
+ * Modes (first command line argument):
+ *   grid       Full Cartesian grid over lambda, xi, b and m (default). "grid profile" also
+ *              writes per-phase times and hardware counters of every run to profile.csv.
+ *              "grid triage" writes analytic estimates within 0.1% instead of simulating
+ *              (column approximate), and simulates only the remaining points.
+ *              "grid summary" writes no rows but, per (lambda, xi, b), the maximum T_RH
+ *              and its m, the median T_RH, the toMatter fraction and a histogram of t_eq
+ *              to aggregates.csv, updated every 1000 results.
+ *   adaptive   Coarse mass ladder per (lambda, xi, b), refined only where the results change.
+ *   boundary   Transition masses between matter-first and radiation-first evolution.
+ *   sample     Space-filling points over log m, log lambda and log b for every xi:
+ *              sample [sobol|halton|lhs] [budget] [first index]. A run can be resumed from
+ *              the index of its first missing point.
+ *   trajectory rho_stiff, rho_phi and rho_chi over all phases of selected points, to the
+ *              binary trajectories.bin: trajectory m lambda b xi [m lambda b xi ...].
+ *   inverse    Masses at which T_RH takes a target value, found by root finding in log m
+ *              over 1 GeV to 1e28 GeV: inverse T_RH lambda b xi.
+ *   serve      Stay resident and answer parameter requests from stdin on stdout
+ *              (see SimulationService for the line format).
+ *
+ * "--precision <relative error>" anywhere on the command line sets the precision asked of
+ * t_eq, tau_eq and T_RH (PrecisionTargets, default 1e-8) in every mode but inverse, which
+ * derives it from its tolerance. Stored results are reused only at the same precision.
  * ===============================================================================================
  */
 
 #include <iostream>
+#include <thread>
 #include <vector>
 #include <memory>
 #include <chrono>
+#include <string>
+#include <filesystem>
 
 #include "parameters/parameters.hpp"
 #include "simulation/simulation_manager.hpp"
+#include "simulation/adaptive_mass_sweep.hpp"
+#include "simulation/inverse_reheating_solver.hpp"
+#include "simulation/phase_boundary_tracer.hpp"
+#include "simulation/simulation_service.hpp"
+#include "simulation/space_filling_sampler.hpp"
+#include "simulation/trajectory.hpp"
+#include "storage/result_store.hpp"
+#include "writers/aggregating_writer.hpp"
+#include "writers/boundary_csv_writer.hpp"
 #include "writers/csv_writer.hpp"
+#include "writers/profile_csv_writer.hpp"
+#include "writers/trajectory_writer.hpp"
 
 using namespace std::chrono;
 
-/*
-TODO:
-    2. Add support for multiple channels.
-*/
+int main(int argc, char* argv[])
+{
+    // Take "--precision <relative error>" out of the arguments of the mode.
+    PrecisionTargets precision;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; i++)
+    {
+        if (std::string(argv[i]) == "--precision" && i + 1 < argc)
+        {
+            double relative = std::stod(argv[++i]);
+            precision = PrecisionTargets{.equalityTime = relative, .reheatingTemp = relative};
+        }
+        else
+        {
+            args.push_back(argv[i]);
+        }
+    }
+    argc = static_cast<int>(args.size());
+    argv = args.data();
 
+    std::string mode = (argc > 1) ? argv[1] : "grid";
+
+    if (mode == "serve")
+    {
+        SimulationService service(std::cin, std::cout, std::thread::hardware_concurrency(),
+                                  Outputs::Default, precision);
+        service.run();
+        return 0;
+    }
 
-int main()
-{
     std::vector<ModelParameters> params;
     ModelParameters p;
 
-    std::vector<double> lambdaValues{0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001};
-    std::vector<double> bValues{10.0, 1.0, 0.1};
-    std::vector<double> xiValues{0.0, 1.0 / 6.0};  // Minimal and conformal coupling
-    std::vector<double> mValues{};
+    if (mode == "inverse")
+    {
+        if (argc != 6)
+        {
+            std::cerr << "Usage: inverse T_RH lambda b xi\n";
+            return 1;
+        }
+
+        double target = std::stod(argv[2]);
+        p.lambda = std::stod(argv[3]);
+        p.b = std::stod(argv[4]);
+        p.xi = std::stod(argv[5]);
 
+        InverseReheatingSolver solver(p);
+        for (const auto& solution : solver.solve(target))
+        {
+            std::cout << "m = " << solution.params.m << " GeV in [" << solution.mLow << ", " << solution.mHigh
+                      << "]: T_RH = " << solution.reheatingTemp << " GeV (relative error "
+                      << solution.temperatureError << "), toMatter = " << solution.toMatter
+                      << (solution.atSwitch ? ", T_RH jumps past the target at the toMatter switch" : "")
+                      << (solution.converged ? "" : ", not converged") << "\n";
+        }
+        std::cout << solver.getSimulationCount() << " simulations." << std::endl;
+        return 0;
+    }
 
-    // Generate mass points.
-    auto generateMassPoints = [&](double start, double end, int samples)
+    if (mode == "trajectory")
     {
-        double step = pow(10.0, 1.0 / samples);
-        for (double m = start; m < end; m*=step)
+        if (argc < 6 || (argc - 2) % 4 != 0)
         {
-            mValues.push_back(m);
+            std::cerr << "Usage: trajectory m lambda b xi [m lambda b xi ...]\n";
+            return 1;
         }
-    };
 
-    // Generate more points in the low mass range where things are interesting.
-    generateMassPoints(1e0, 1e9, 100);  // Low range
-    generateMassPoints(1e9, 1e28, 60);  // High range
+        TrajectoryWriter writer;
+        for (int i = 2; i + 3 < argc; i += 4)
+        {
+            p.m = std::stod(argv[i]);
+            p.lambda = std::stod(argv[i + 1]);
+            p.b = std::stod(argv[i + 2]);
+            p.xi = std::stod(argv[i + 3]);
+
+            Simulation sim(p);
+            sim.setPrecision(precision);
+            SimulationResults res = sim.run();
+            if (res.status != SimulationStatus::Ok)
+            {
+                // The equality times of a failed run are NaN; there is no trajectory to trace.
+                std::cerr << "Skipping m = " << p.m << ", lambda = " << p.lambda << ", b = " << p.b
+                          << ", xi = " << p.xi << ": " << statusName(res.status) << "\n";
+                continue;
+            }
+            writer.begin(p);
+            TrajectoryTracer(p).trace(res, [&](const TrajectoryPoint& point) {writer.write(point);});
+            writer.end();
+        }
+        return 0;
+    }
+
+    std::vector<double> lambdaValues{0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001};
+    std::vector<double> bValues{10.0, 1.0, 0.1};
+    std::vector<double> xiValues{0.0, 1.0 / 6.0};  // Minimal and conformal coupling
+    std::vector<double> mValues{};
 
 
+    // One entry per (lambda, xi, b) for the modes that choose the masses themselves.
+    std::vector<ModelParameters> slices;
     for (const auto& lambda : lambdaValues)
     {
         for (const auto& xi : xiValues)
         {
             for (const auto& b : bValues)
             {
-                for (const auto& m : mValues)
-                {
-                    p.lambda = lambda;
-                    p.b = b;
-                    p.xi = xi;
-                    p.m = m;
-                    params.push_back(p);
-                }   
+                p.lambda = lambda;
+                p.b = b;
+                p.xi = xi;
+                slices.push_back(p);
             }
         }
     }
 
     // Insert filename you want to save results in the parentheses below.
-    auto outputWriter = std::make_unique<CSVWriter>("test.csv");
+    std::string resultsFile = "test.csv";
 
     auto start = steady_clock::now();
-    std::cout << "Beginning simulation with " << params.size() << " parameter combinations." << std::endl;
 
-    SimulationManager manager(std::move(params), std::move(outputWriter));
-    manager.run(); 
+    if (mode == "adaptive")
+    {
+        AdaptiveSweepSettings settings;
+        settings.mMin = 1e0;
+        settings.mMax = 1e28;
+        settings.precision = precision;
+        std::cout << "Beginning adaptive simulation with " << slices.size() << " (lambda, xi, b) slices." << std::endl;
+
+        AdaptiveMassSweep sweep(std::move(slices), std::make_unique<CSVWriter>(resultsFile), settings);
+        sweep.run();
+        std::cout << "Simulations run: " << sweep.getSimulationCount() << std::endl;
+    }
+    else if (mode == "boundary")
+    {
+        BoundaryTracerSettings settings;
+        settings.mMin = 1e0;
+        settings.mMax = 1e28;
+        settings.tolerance = 1e-3;
+        settings.precision = precision;
+        std::cout << "Tracing the phase boundary for " << slices.size() << " (lambda, xi, b) slices." << std::endl;
+
+        PhaseBoundaryTracer tracer(std::move(slices), settings);
+        BoundaryCSVWriter boundaryWriter("boundary.csv");
+        for (const auto& point : tracer.run())
+        {
+            boundaryWriter.write(point);
+        }
+        std::cout << "Simulations run: " << tracer.getSimulationCount() << std::endl;
+    }
+    else if (mode == "sample")
+    {
+        std::string method = (argc > 2) ? argv[2] : "sobol";
+        SamplerSettings settings;
+        settings.mMin = 1e0;
+        settings.mMax = 1e28;
+        settings.lambdaMin = lambdaValues.back();
+        settings.lambdaMax = lambdaValues.front();
+        settings.bMin = bValues.back();
+        settings.bMax = bValues.front();
+        settings.budget = (argc > 3) ? std::stoull(argv[3]) : 1000;
+        std::uint64_t first = (argc > 4) ? std::stoull(argv[4]) : 0;
+
+        if (method == "sobol") {settings.method = SamplingMethod::Sobol;}
+        else if (method == "halton") {settings.method = SamplingMethod::Halton;}
+        else if (method == "lhs") {settings.method = SamplingMethod::LatinHypercube;}
+        else
+        {
+            std::cerr << "Unknown sampling method: " << method << "\n";
+            return 1;
+        }
+
+        std::cout << "Sampling points " << first << " to " << settings.budget << " for "
+                  << xiValues.size() << " xi values." << std::endl;
+
+        ResultStore store((std::filesystem::current_path().parent_path() / "results" / "results.store").string());
+        SimulationManager manager({}, std::make_unique<CSVWriter>(resultsFile));
+        manager.setResultStore(&store);
+        manager.setPrecision(precision);
+        manager.setBudget(TaskBudget{.seconds = 120.0}, 1);
+        std::vector<SpaceFillingSampler> samplers;
+        for (const auto& xi : xiValues)
+        {
+            p.xi = xi;
+            samplers.emplace_back(p, settings);
+        }
+
+        manager.start();
+        // Points are generated while the workers run.
+        for (std::uint64_t i = first; i < settings.budget; i++)
+        {
+            for (const auto& sampler : samplers)
+            {
+                manager.submit(sampler.point(i));
+            }
+        }
+        manager.close();
+    }
+    else if (mode == "grid")
+    {
+        // Generate mass points.
+        auto generateMassPoints = [&](double start, double end, int samples)
+        {
+            double step = pow(10.0, 1.0 / samples);
+            for (double m = start; m < end; m*=step)
+            {
+                mValues.push_back(m);
+            }
+        };
+
+        // Generate more points in the low mass range where things are interesting.
+        generateMassPoints(1e0, 1e9, 100);  // Low range
+        generateMassPoints(1e9, 1e28, 60);  // High range
+
+
+        for (const auto& lambda : lambdaValues)
+        {
+            for (const auto& xi : xiValues)
+            {
+                for (const auto& b : bValues)
+                {
+                    for (const auto& m : mValues)
+                    {
+                        p.lambda = lambda;
+                        p.b = b;
+                        p.xi = xi;
+                        p.m = m;
+                        params.push_back(p);
+                    }   
+                }
+            }
+        }
+
+        std::cout << "Beginning simulation with " << params.size() << " parameter combinations." << std::endl;
+
+        std::string option = (argc > 2) ? argv[2] : "";
+        bool profile = option == "profile";
+        std::unique_ptr<ResultsWriter> writer;
+        AggregatingWriter* summary = nullptr;
+        if (option == "summary")
+        {
+            using Kind = Aggregation::Kind;
+            const double nan = SimulationResults::notComputed;
+            auto temperature = [](const SimulationResults& r) {return r.reheating_temp;};
+            auto mass = [](const SimulationResults& r) {return r.params.m;};
+            auto matter = [=](const SimulationResults& r) {return r.status == SimulationStatus::Ok ? double(r.toMatter) : nan;};
+            auto equality = [](const SimulationResults& r) {return r.t_eq;};
+            std::vector<Aggregation> aggregations{
+                {.kind = Kind::Count, .name = "finished", .quantity = temperature},
+                {.kind = Kind::Max, .name = "maxReheating_temp[GeV]", .quantity = temperature},
+                {.kind = Kind::ArgMax, .name = "m_maxReheating_temp[GeV]", .quantity = temperature, .argument = mass},
+                {.kind = Kind::Quantile, .name = "medianReheating_temp[GeV]", .quantity = temperature, .probability = 0.5},
+                {.kind = Kind::Mean, .name = "toMatterFraction", .quantity = matter},
+                {.kind = Kind::Histogram, .name = "t_eq[GeV^-1]", .quantity = equality,
+                 .lower = 1e-8, .upper = 1e22, .bins = 30, .logarithmic = true},
+            };
+            auto aggregating = std::make_unique<AggregatingWriter>(GroupBy::Lambda | GroupBy::Xi | GroupBy::B,
+                                                                   std::move(aggregations), nullptr, 1000);
+            summary = aggregating.get();
+            writer = std::move(aggregating);
+        }
+        else
+        {
+            writer = std::make_unique<CSVWriter>(resultsFile);
+        }
+        if (profile)
+        {
+            std::cout << "Profiling with " << (Profiler::countersAvailable() ? "hardware counters." : "times only.") << std::endl;
+            writer = std::make_unique<ProfileCSVWriter>(std::move(writer));
+        }
+
+        // Points finished by an earlier (possibly interrupted) run are taken from the store.
+        ResultStore store((std::filesystem::current_path().parent_path() / "results" / "results.store").string());
+        SimulationManager manager(std::move(params), std::move(writer));
+        manager.setResultStore(&store);
+        manager.setPrecision(precision);
+        manager.setProfiling(profile);
+        if (option == "triage")
+        {
+            manager.setTriage(1e-3);
+        }
+        // Abandon pathological points after two minutes; retry them once at the end with 4x the time.
+        manager.setBudget(TaskBudget{.seconds = 120.0}, 1);
+        manager.run(); 
+        if (summary)
+        {
+            summary->emit();
+        }
+    }
+    else
+    {
+        std::cerr << "Unknown mode: " << mode << "\n";
+        return 1;
+    }
     
     auto end = steady_clock::now();
 
@@ -5,7 +5,12 @@
 #include <boost/math/special_functions/airy.hpp>
 #include <boost/math/special_functions/bessel.hpp>
 #include <cmath>
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <numbers>
 #include "model/energy/creation_decay.hpp"
+#include "utils/profiler.hpp"
 
 using boost::math::cyl_hankel_1;
 using boost::math::cyl_hankel_2;
@@ -16,56 +21,175 @@ using boost::math::cyl_neumann;
 
 double PhiCreationRate(ModelParameters& p, double t)
 {
-    double arg = -pow((3.0 * p.m * t / 2.0), 2.0 / 3.0);
+    ProfileScope scope(ProfilePhase::Creation);
+    return PhiCreationRate<double>(p.m, p.b, t);
+}
+
 
-    double airyAi = boost::math::airy_ai(arg);
-    double airyBi = boost::math::airy_bi(arg);
+double airyModulusLogDerivative(double x)
+{
+    if (x > -20.0)
+    {
+        double ai = airy_ai(x);
+        double bi = airy_bi(x);
+        return 2.0 * (ai * boost::math::airy_ai_prime(x) + bi * boost::math::airy_bi_prime(x))
+               / (ai * ai + bi * bi);
+    }
 
-    double airySum = pow(airyAi, 2.0) + pow(airyBi, 2.0);
+    const double z = -x;
+    // (1 * 3 * 5 * ... * (6k - 1)) / (k! 96^k)
+    const std::array<double, 4> a = {15.0 / 96.0, 10395.0 / 18432.0, 34459425.0 / 5308416.0,
+                                     316234143225.0 / 2038431744.0};
+    double series = 1.0;
+    double derivative = 0.0;
+    for (std::size_t k = 0; k < a.size(); k++)
+    {
+        double power = 3.0 * (k + 1);
+        series += a[k] * std::pow(z, -power);
+        derivative -= power * a[k] * std::pow(z, -power - 1.0);
+    }
+    // d/dx = -d/dz of log M^2 = -log(pi) - log(z) / 2 + log(series)
+    return 1.0 / (2.0 * z) - derivative / series;
+}
 
-    double factor = 3.0 * pow(p.m * p.b, 13.0 / 3.0) / (32.0 * p.b);
+double decayBesselOrderDerivative(double m, double alpha, double t)
+{
+    const double x = m * t;
+    const double mu = 4.0 * alpha * alpha;
+    if (x < 20.0 + 4.0 * mu)
+    {
+        constexpr double orderStep = 1e-4;
+        return (decayBesselTerm<double>(m, alpha + orderStep, t)
+                - decayBesselTerm<double>(m, alpha - orderStep, t)) / (2.0 * orderStep);
+    }
 
-    return factor * t * airySum;
+    // With (J_a^2 + N_a^2)(x) ~ 2 / (pi x) sum_k c_k P_k(mu) (2x)^(-2k), where
+    // c_k = (2k - 1)!! / (2k)!! and P_k = (mu - 1)(mu - 9)...(mu - (2k - 1)^2), Lommel's
+    // integral gives m^2 B = (x + sum_k c_k P_k 4^(-k) x^(1 - 2k) / (1 - 2k)) / (16 pi) with no
+    // constant. d/d alpha = 8 alpha d/d mu.
+    double P = 1.0;
+    double dP = 0.0;
+    double c = 1.0;
+    double power = x;                           // 4^(-k) x^(1 - 2k)
+    double sum = 0.0;
+    for (int k = 1; k <= 6; k++)
+    {
+        double factor = mu - (2.0 * k - 1.0) * (2.0 * k - 1.0);
+        dP = dP * factor + P;
+        P *= factor;
+        c *= (2.0 * k - 1.0) / (2.0 * k);
+        power /= 4.0 * x * x;
+        sum += c * dP * power / (1.0 - 2.0 * k);
+    }
+    return alpha * sum / (2.0 * std::numbers::pi * m * m);
 }
 
 
-ChiDecayRate::ChiDecayRate(ModelParameters& p_, double n_, double t0_):
-        p{p_}, n{n_}, t0{t0_}, alpha{p_.alpha(n_)}
+ChiDecayRate::ChiDecayRate(ModelParameters& p_, double n_, double t0_,
+                           std::pmr::memory_resource* resource):
+        p{p_}, n{n_}, t0{t0_}, groups{resource}, channelGroup{resource}, channelCoupling{resource}
         {
-            double argt0 = p.m * t0;
-            double factor2 = pow(p.lambda * t0, 2.0) / 64.0;
-
-
-            double J_alpha_t0  = boost::math::cyl_bessel_j(alpha, argt0);
-            double J_alpha1_t0 = boost::math::cyl_bessel_j(alpha - 1.0, argt0);
-            double J_alphaP1_t0 = boost::math::cyl_bessel_j(alpha + 1.0, argt0);
-            double N_alpha_t0  = boost::math::cyl_neumann(alpha, argt0);
-            double N_alpha1_t0 = boost::math::cyl_neumann(alpha - 1.0, argt0);
-            double N_alphaP1_t0 = boost::math::cyl_neumann(alpha + 1.0, argt0);
-        
-            double bessel2 = pow(J_alpha_t0, 2) 
-                                  - J_alpha1_t0 * J_alphaP1_t0 
-                                  - N_alphaP1_t0 * N_alpha1_t0 
-                                  + pow(N_alpha_t0, 2);
-            initialBessel = factor2 * bessel2;        
+            if (p.channels.empty())
+            {
+                addChannel(p.lambda, p.xi);
+            }
+            for (const auto& channel : p.channels)
+            {
+                addChannel(channel.lambda, channel.xi);
+            }
         };
 
+
+ChiDecayRate::ChiDecayRate(const ChiDecayRate& other):
+        p{other.p}, n{other.n}, t0{other.t0},
+        groups{other.groups, other.groups.get_allocator()},
+        channelGroup{other.channelGroup, other.channelGroup.get_allocator()},
+        channelCoupling{other.channelCoupling, other.channelCoupling.get_allocator()}
+        {};
+
+
+void ChiDecayRate::addChannel(double lambda, double xi)
+        {
+            double alpha = ModelParameters::alpha(n, xi);
+            auto group = std::find_if(groups.begin(), groups.end(),
+                                      [&](const AlphaGroup& g) {return g.alpha == alpha;});
+            if (group == groups.end())
+            {
+                groups.push_back(AlphaGroup{alpha, 0.0, besselTerm(alpha, t0), std::nullopt});
+                group = std::prev(groups.end());
+            }
+
+            double couplingSquared = lambda * lambda;
+            group->couplingSquared += couplingSquared;
+            channelGroup.push_back(static_cast<std::size_t>(group - groups.begin()));
+            channelCoupling.push_back(couplingSquared);
+        }
+
+
+template<typename Real>
+Real ChiDecayRate::besselTerm(double alpha, const Real& t) const
+        {
+            return decayBesselTerm<Real>(Real(p.m), Real(alpha), t);
+        }
+
+/**
+ * Decay rate of a group per unit coupling, besselTerm(t) - besselTerm(t0).
+ */
+double ChiDecayRate::groupRate(const AlphaGroup& group, double t) const
+        {
+            if (t == t0)
+            {
+                return 0.0;
+            }
+
+            ProfileScope scope(ProfilePhase::Decay);
+            double bessel1 = besselTerm(group.alpha, t);
+            double rate = bessel1 - group.initialBessel;
+#ifdef REHEATING_MIXED_PRECISION
+            // Condition number of the difference is (|a| + |b|) / |a - b|.
+            if (std::abs(bessel1) + std::abs(group.initialBessel) > maxCondition * std::abs(rate))
+            {
+                if (!group.initialBesselExtended)
+                {
+                    group.initialBesselExtended = besselTerm(group.alpha, ExtendedPrecision(t0));
+                }
+                return static_cast<double>(besselTerm(group.alpha, ExtendedPrecision(t))
+                                           - *group.initialBesselExtended);
+            }
+#endif
+            return rate;
+        }
+
 // Use as function.
 double ChiDecayRate::operator()(double t) const
+        {
+            double rate = 0.0;
+            for (const auto& group : groups)
+            {
+                rate += group.couplingSquared * groupRate(group, t);
+            }
+            return rate;
+        }
+
+double ChiDecayRate::derivative(double t) const
         {
             double arg = p.m * t;
-            double factor1 = pow(p.lambda * t, 2.0) / 64.0;
-            // Bessel functions for t
-            double J_alpha_t  = boost::math::cyl_bessel_j(alpha, arg);
-            double J_alpha1_t = boost::math::cyl_bessel_j(alpha - 1.0, arg);
-            double J_alphaP1_t = boost::math::cyl_bessel_j(alpha + 1.0, arg);
-            double N_alpha_t  = boost::math::cyl_neumann(alpha, arg);
-            double N_alpha1_t = boost::math::cyl_neumann(alpha - 1.0, arg);
-            double N_alphaP1_t = boost::math::cyl_neumann(alpha + 1.0, arg);
-
-            double bessel1 = pow(J_alpha_t, 2) 
-                                - J_alpha1_t * J_alphaP1_t 
-                                - N_alphaP1_t * N_alpha1_t 
-                                + pow(N_alpha_t, 2);
-            return factor1 * bessel1 - initialBessel;
-        }
\ No newline at end of file
+            double rate = 0.0;
+            for (const auto& group : groups)
+            {
+                double J = cyl_bessel_j(group.alpha, arg);
+                double N = cyl_neumann(group.alpha, arg);
+                rate += group.couplingSquared * (J * J + N * N);
+            }
+            return t * rate / 32.0;
+        }
+
+double ChiDecayRate::channel(std::size_t c, double t) const
+        {
+            return channelCoupling[c] * groupRate(groups[channelGroup[c]], t);
+        }
+
+std::size_t ChiDecayRate::channelCount() const
+        {
+            return channelCoupling.size();
+        }
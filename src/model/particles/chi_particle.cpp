@@ -1,11 +1,48 @@
 #include <cmath>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <boost/math/tools/roots.hpp>
 
 #include "model/particles/chi_particle.hpp"
 #include "model/particles/phi_particle.hpp"
+#include "model/particles/phase_context.hpp"
+#include "model/particles/phase_densities.hpp"
 #include "model/energy/creation_decay.hpp"
+#include "model/epoch.hpp"
 #include "utils/integration.hpp"
 
 
+namespace
+{
+    // Decay rate into the channel, or the total one, and rho_phi at t. The total rate is
+    // passed on to rho_phi, which would evaluate it again otherwise.
+    template<Epoch E>
+    std::pair<double, double> rateAndPhi(const PhaseContext<E>& context, const std::optional<std::size_t>& channel,
+                                         double t)
+    {
+        if (channel)
+        {
+            return {context.decay.channel(*channel, t), context.rhoPhi(t)};
+        }
+        double rate = context.decay(t);
+        return {rate, context.rhoPhi(t, rate)};
+    }
+}
+
+
+void ChiParticle::rebind(const ModelParameters& _p)
+{
+    p = _p;
+    initialRhoMatterChannels.clear();
+    initialRhoRadiationChannels.clear();
+}
+
+void ChiParticle::setErrorBudget(const IntegrationUtils::ErrorBudget& budget)
+{
+    quadrature = budget;
+}
+
 void ChiParticle::setInitialRhoMatter(const double& rhoInit)
 {
     this->initialRhoMatter = rhoInit;
@@ -26,69 +63,206 @@ double ChiParticle::getInitialRhoRadiation() const
     return initialRhoRadiation;
 }
 
-EnergyDensity ChiParticle::energyDensityStiff()
-{   
-    constexpr double n = 1.0; // For stiff matter universe, n = 1.
-    //constexpr double n = 0.0;
-    ChiDecayRate chiDecay(this->p, n, this->p.t0);
-    return [this, chiDecay](double t) -> double
+void ChiParticle::setInitialRhoMatter(const double& rhoInit, std::size_t channel)
+{
+    initialRhoMatterChannels.resize(std::max(initialRhoMatterChannels.size(), channel + 1));
+    initialRhoMatterChannels[channel] = rhoInit;
+}
+
+double ChiParticle::getInitialRhoMatter(std::size_t channel) const
+{
+    return initialRhoMatterChannels.at(channel);
+}
+
+void ChiParticle::setInitialRhoRadiation(const double& rhoInit, std::size_t channel)
+{
+    initialRhoRadiationChannels.resize(std::max(initialRhoRadiationChannels.size(), channel + 1));
+    initialRhoRadiationChannels[channel] = rhoInit;
+}
+
+double ChiParticle::getInitialRhoRadiation(std::size_t channel) const
+{
+    return initialRhoRadiationChannels.at(channel);
+}
+
+std::size_t ChiParticle::channelCount() const
+{
+    return p.decayChannels().size();
+}
+
+EnergyDensity ChiParticle::energyDensityStiff(std::optional<std::size_t> channel)
+{
+    auto context = phiParticle->phaseContext<Epoch::Stiff>(this->p.t0);
+    return [this, context, channel](double t) -> double
     {
-        double prefactor = 1 / pow(t, 4.0 / 3.0);
-        EnergyDensity rhoPhi = phiParticle->energyDensityStiff();
-        
         auto integrand = [&](double tprime)
         {
-            double val = chiDecay(tprime) * rhoPhi(tprime)
-                                * pow(tprime, 4.0 / 3.0);
-            return val;
+            auto [rate, rhoPhi] = rateAndPhi(*context, channel, tprime);
+            return chiSource<Epoch::Stiff>(rate, rhoPhi, tprime);
         };
-    
-        double integralResult = IntegrationUtils::integrate(integrand, this->p.t0, t);
-        return prefactor * integralResult;
+
+        double integralResult = IntegrationUtils::integrate(integrand, this->p.t0, t, this->quadrature);
+        return chiDensity<Epoch::Stiff>(integralResult, this->p.t0, t, 0.0);
     };
 }
 
 
-EnergyDensity ChiParticle::energyDensityMatter(double t0)
+EnergyDensity ChiParticle::energyDensityMatter(double t0, std::optional<std::size_t> channel)
 {
-    constexpr double n = 4.0; // n=4 for matter domination 
-    //constexpr double n = 0.0; 
-    ChiDecayRate chiDecay(this->p, n, t0);
+    auto context = phiParticle->phaseContext<Epoch::Matter>(t0);
 
-    return [this, t0, chiDecay](double t)->double{
-        double initialRho = this->getInitialRhoMatter() * pow(t0 / t, 8.0 / 3.0);
-        double prefactor = pow((1 / t), 8.0 / 3.0);
-        EnergyDensity rhoMat = phiParticle->energyDensityMatter(t0);
+    return [this, t0, context, channel](double t)->double{
+        double rho0 = channel ? this->getInitialRhoMatter(*channel) : this->getInitialRhoMatter();
         auto integrand = [&] (double tprime)
         {
-            double val = chiDecay(tprime) * rhoMat(tprime) * pow(tprime, 8.0 / 3.0);
-            return val;
+            auto [rate, rhoPhi] = rateAndPhi(*context, channel, tprime);
+            return chiSource<Epoch::Matter>(rate, rhoPhi, tprime);
         };
 
-        auto integral = IntegrationUtils::integrate(integrand, t0, t);
-        return prefactor * integral + initialRho;
+        auto integral = IntegrationUtils::integrate(integrand, t0, t, this->quadrature);
+        return chiDensity<Epoch::Matter>(integral, t0, t, rho0);
     };
 }
 
-EnergyDensity ChiParticle::energyDensityRadiation(double t0)
+EnergyDensity ChiParticle::energyDensityRadiation(double t0, std::optional<std::size_t> channel)
 {
-    constexpr double n = 2.0; // n = 2 in radiation dominated universe
-    //constexpr double n = 0.0;
-    ChiDecayRate chiDecay(this->p, n, t0);
-
-    return [this, t0, chiDecay](double t)->double{
-        double time = pow(t0, (1.0 / 2.0)) / pow(t, (1.0 / 2.0));
-        double initialRho = this->getInitialRhoRadiation() * pow(time, 4);  // Rho_chi_mat(tau_eq)
-        double prefactor = 1 / pow(t, 2);
-        EnergyDensity rhoRad = phiParticle->energyDensityRadiation(t0);
+    auto context = phiParticle->phaseContext<Epoch::Radiation>(t0);
 
+    return [this, t0, context, channel](double t)->double{
+        double rho0 = channel ? this->getInitialRhoRadiation(*channel) : this->getInitialRhoRadiation();  // Rho_chi_mat(tau_eq)
         auto integrand = [&] (double tprime)
         {
-            double val = chiDecay(tprime) * rhoRad(tprime) * pow(tprime, 2.0);
-            return val;
+            auto [rate, rhoPhi] = rateAndPhi(*context, channel, tprime);
+            return chiSource<Epoch::Radiation>(rate, rhoPhi, tprime);
         };
 
-        auto integral = IntegrationUtils::integrate(integrand, t0, t);
-        return prefactor * integral + initialRho;
+        auto integral = IntegrationUtils::integrate(integrand, t0, t, this->quadrature);
+        return chiDensity<Epoch::Radiation>(integral, t0, t, rho0);
+    };
+}
+
+
+/*
+ * rho = (integral of source + C) / a^4(t) with the source rate * rho_phi * a^4, so that
+ * d rho / dt = rate(t) rho_phi(t) - a4Exponent rho / t in every phase.
+ */
+
+EnergyDensityDerivative ChiParticle::energyDensityStiffDerivative(std::optional<std::size_t> channel)
+{
+    using Stiff = EpochTraits<Epoch::Stiff>;
+    auto context = phiParticle->phaseContext<Epoch::Stiff>(this->p.t0);
+    return [context, channel](double t, double rho) -> double
+    {
+        auto [rate, rhoPhi] = rateAndPhi(*context, channel, t);
+        return rate * rhoPhi - Stiff::a4Exponent * rho / t;
+    };
+}
+
+
+EnergyDensityDerivative ChiParticle::energyDensityMatterDerivative(double t0, std::optional<std::size_t> channel)
+{
+    using Matter = EpochTraits<Epoch::Matter>;
+    auto context = phiParticle->phaseContext<Epoch::Matter>(t0);
+    return [context, channel](double t, double rho) -> double
+    {
+        auto [rate, rhoPhi] = rateAndPhi(*context, channel, t);
+        return rate * rhoPhi - Matter::a4Exponent * rho / t;
+    };
+}
+
+
+EnergyDensityDerivative ChiParticle::energyDensityRadiationDerivative(double t0, std::optional<std::size_t> channel)
+{
+    using Radiation = EpochTraits<Epoch::Radiation>;
+    auto context = phiParticle->phaseContext<Epoch::Radiation>(t0);
+    return [context, channel](double t, double rho) -> double
+    {
+        auto [rate, rhoPhi] = rateAndPhi(*context, channel, t);
+        return rate * rhoPhi - Radiation::a4Exponent * rho / t;
+    };
+}
+
+
+std::pair<double, double> ChiParticle::radiationPeak(double t0, double tMax, double tol)
+{
+    constexpr int panelsPerDecade = 10;
+    auto context = phiParticle->phaseContext<Epoch::Radiation>(t0);
+
+    // rho_chi(t) = (I(t) + C) / t^2, where I is the integral of the decay source from t0.
+    const double C = this->getInitialRhoRadiation() * t0 * t0;
+    auto source = [&](double t)
+    {
+        auto [rate, rhoPhi] = rateAndPhi(*context, std::nullopt, t);
+        return chiSource<Epoch::Radiation>(rate, rhoPhi, t);
     };
+    // Source and source / t. The latter gives the time integral of rho_chi by parts.
+    auto moments = [&](double t) -> std::array<double, 2>
+    {
+        double s = source(t);
+        return {s, s / t};
+    };
+
+    int panels = std::max(1, static_cast<int>(std::ceil(panelsPerDecade * log10(tMax / t0))));
+    double ratio = pow(tMax / t0, 1.0 / panels);
+    std::pmr::vector<double> times({t0}, resource);
+    std::pmr::vector<double> I({0.0}, resource);
+    std::pmr::vector<double> J({0.0}, resource);
+    times.reserve(panels + 1);
+    I.reserve(panels + 1);
+    J.reserve(panels + 1);
+
+    std::size_t peak = 0;
+    double rhoPeak = C / (t0 * t0);
+    for (int i = 1; i <= panels; i++)
+    {
+        double t = (i == panels) ? tMax : t0 * pow(ratio, i);
+        auto [dI, dJ] = IntegrationUtils::integrateJointly<2>(moments, times.back(), t, tol);
+        times.push_back(t);
+        I.push_back(I.back() + dI);
+        J.push_back(J.back() + dJ);
+
+        double rho = (I.back() + C) / (t * t);
+        if (rho > rhoPeak)
+        {
+            peak = i;
+            rhoPeak = rho;
+        }
+    }
+
+    double tPeak = times[peak];
+    double IPeak = I[peak];
+    double JPeak = J[peak];
+
+    // Interior maximum: refine inside the neighbouring panels, where d(rho_chi)/dt = 0
+    // i.e. t * source(t) = 2 (I(t) + C).
+    if (peak > 0 && peak < times.size() - 1)
+    {
+        double tLow = times[peak - 1];
+        double tHigh = times[peak + 1];
+        auto slope = [&](double t)
+        {
+            auto [dI] = IntegrationUtils::integrateJointly<1>(
+                [&](double tprime) -> std::array<double, 1> {return {source(tprime)};}, tLow, t, tol);
+            return t * source(t) - 2.0 * (I[peak - 1] + dI + C);
+        };
+
+        double fLow = slope(tLow);
+        double fHigh = slope(tHigh);
+        if (fLow > 0 && fHigh < 0)
+        {
+            const int digits = std::numeric_limits<double>::digits - 10;
+            std::uintmax_t maxIter = 100;
+            auto root = boost::math::tools::toms748_solve(slope, tLow, tHigh, fLow, fHigh,
+                boost::math::tools::eps_tolerance<double>(digits), maxIter);
+            tPeak = (root.first + root.second) / 2.0;
+
+            auto [dI, dJ] = IntegrationUtils::integrateJointly<2>(moments, tLow, tPeak, tol);
+            IPeak = I[peak - 1] + dI;
+            JPeak = J[peak - 1] + dJ;
+        }
+    }
+
+    // Integral of rho_chi over [t0, tPeak].
+    double integral = radiationChiIntegral(IPeak, JPeak, C, t0, tPeak);
+    return {tPeak, integral};
 }
@@ -1,11 +1,16 @@
 #include <cmath>
 #include <sstream>
 #include <iomanip>
+#include <boost/math/special_functions/airy.hpp>
 
 #include "model/particles/phi_particle.hpp"
+#include "model/particles/phase_context.hpp"
+#include "model/particles/phase_densities.hpp"
 #include "model/energy/creation_decay.hpp"
+#include "model/epoch.hpp"
 #include "utils/types.hpp"
 #include "utils/integration.hpp"
+#include "utils/profiler.hpp"
 
 
 double quantize(const double& value, int digits = 30) {
@@ -34,80 +39,175 @@ double PhiParticle::getInitialRhoRadiation() const
     return initialRhoRadiation;
 }
 
-double PhiParticle::creationRate(double t)
+void PhiParticle::rebind(const ModelParameters& _p)
 {
-    double arg = -pow((3.0 * p.m * t / 2.0), 2.0 / 3.0);
+    // The stiff density depends on every parameter except G_N.
+    ModelParameters previous = p;
+    previous.G_N = _p.G_N;
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (!(previous == _p))
+    {
+        rhoPhiCache.clear();  // Nodes go back to the memory resource for reuse.
+    }
+    // The decay rates of the contexts hold Bessel functions of the old mass at t0.
+    stiffContext.reset();
+    matterContext.reset();
+    radiationContext.reset();
+    p = _p;
+}
 
-    double airyAi = boost::math::airy_ai(arg);
-    double airyBi = boost::math::airy_bi(arg);
+void PhiParticle::setErrorBudget(const IntegrationUtils::ErrorBudget& budget)
+{
+    if (!(budget == quadrature))
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        rhoPhiCache.clear();
+    }
+    quadrature = budget;
+}
 
-    double airySum = pow(airyAi, 2.0) + pow(airyBi, 2.0);
+double PhiParticle::creationRate(double t)
+{
+    ProfileScope scope(ProfilePhase::Creation);
+    return PhiCreationRate<double>(p.m, p.b, t);
+}
 
-    double factor = 3.0 * pow(p.m * p.b, 13.0 / 3.0) / (32.0 * p.b);
+template<>
+std::shared_ptr<const PhaseContext<Epoch::Stiff>>& PhiParticle::cachedContext<Epoch::Stiff>()
+{
+    return stiffContext;
+}
 
-    return factor * t * airySum;
+template<>
+std::shared_ptr<const PhaseContext<Epoch::Matter>>& PhiParticle::cachedContext<Epoch::Matter>()
+{
+    return matterContext;
 }
 
-EnergyDensity PhiParticle::energyDensityStiff()
+template<>
+std::shared_ptr<const PhaseContext<Epoch::Radiation>>& PhiParticle::cachedContext<Epoch::Radiation>()
 {
-    constexpr double n = 1.0;
-    //constexpr double n = 0.0;
-    ChiDecayRate chiDecay(this->p, n, this->p.t0);
+    return radiationContext;
+}
 
-    return [this, chiDecay](double t) -> double
+template<Epoch E>
+std::shared_ptr<const PhaseContext<E>> PhiParticle::phaseContext(double t0)
+{
+    double rhoPhi0 = 0.0;
+    if constexpr (E == Epoch::Matter)
+    {
+        rhoPhi0 = initialRhoMatter;
+    }
+    else if constexpr (E == Epoch::Radiation)
     {
+        rhoPhi0 = initialRhoRadiation;
+    }
 
-       double key = quantize(t, 30);  // Quantize to 30 digits for cache key
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto& context = cachedContext<E>();
+    if (!context || context->t0 != t0 || context->rhoPhi0 != rhoPhi0)
+    {
+        context = std::allocate_shared<PhaseContext<E>>(std::pmr::polymorphic_allocator<PhaseContext<E>>(resource),
+                                                        this, p, t0, rhoPhi0, resource);
+    }
+    return context;
+}
 
-        {
-            std::lock_guard<std::mutex> lock(this->cacheMutex);
-            auto it = this->rhoPhiCache.find(key);
-            if (it != this->rhoPhiCache.end()) {
-                return it->second;
-            }
-        }
-        
-        double prefactor = (1.0 / t) * exp(-chiDecay(t));
+template std::shared_ptr<const PhaseContext<Epoch::Stiff>> PhiParticle::phaseContext<Epoch::Stiff>(double);
+template std::shared_ptr<const PhaseContext<Epoch::Matter>> PhiParticle::phaseContext<Epoch::Matter>(double);
+template std::shared_ptr<const PhaseContext<Epoch::Radiation>> PhiParticle::phaseContext<Epoch::Radiation>(double);
 
-        auto integrand = [&](double tprime)
-        {
-            double val = tprime * this->creationRate(tprime) * exp(chiDecay(tprime));
-            return val;
-        };
 
-        double integralResult = IntegrationUtils::integrate(integrand, this->p.t0, t);
-        double result = prefactor * integralResult;
+double PhiParticle::stiffDensity(double t, const ChiDecayRate& decay)
+{
+    double key = quantize(t, 30);  // Quantize to 30 digits for cache key
 
-        {
-            std::lock_guard<std::mutex> lock(this->cacheMutex);
-            this->rhoPhiCache[key] = result;
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+        auto it = this->rhoPhiCache.find(key);
+        if (it != this->rhoPhiCache.end()) {
+            IntegrationUtils::ErrorTally::record(it->second.relativeError);
+            return it->second.value;
         }
+    }
+
+    double decayT = decay(t);
+    auto integrand = [&](double tprime)
+    {
+        return stiffPhiIntegrand(tprime, this->creationRate(tprime), decay(tprime) - decayT);
+    };
+
+    double error;
+    double integralResult = IntegrationUtils::integrate(integrand, this->p.t0, t, this->quadrature, &error);
+    double result = stiffPhiDensity(integralResult, t);
+
+    {
+        std::lock_guard<std::mutex> lock(this->cacheMutex);
+        this->rhoPhiCache[key] = {result, integralResult != 0 ? error / std::abs(integralResult) : 0.0};
+    }
+
+    return result;
+}
 
 
-        return result;
+EnergyDensity PhiParticle::energyDensityStiff()
+{
+    auto context = phaseContext<Epoch::Stiff>(p.t0);
+    return [context](double t) -> double
+    {
+        return context->rhoPhi(t);
     };
 }
 
 
 EnergyDensity PhiParticle::energyDensityMatter(double t0)
 {
-    constexpr double n = 4.0;
-    //constexpr double n = 0.0;
-    ChiDecayRate chiDecay(this->p, n, t0);
-    return [this, t0, chiDecay](double t)->double{
-        // n = 4 in matter dominated Universe
-        return pow((t0 / t), 2.0) * exp(-chiDecay(t)) * this->getInitialRhoMatter();
+    auto context = phaseContext<Epoch::Matter>(t0);
+    return [context](double t) -> double
+    {
+        return context->rhoPhi(t);
     };
 }
 
 
 EnergyDensity PhiParticle::energyDensityRadiation(double t0)
 {
-    constexpr double n = 2.0;
-    //constexpr double n = 0.0;
-    ChiDecayRate chiDecay(this->p, n, t0);
-    return [this, t0, chiDecay](double t)->double{
-        // n = 2 in radiation dominated Universe
-        return pow((t0 / t), 3.0 / 2.0) * exp(-chiDecay(t)) * this->getInitialRhoRadiation();
-    };    
-}
\ No newline at end of file
+    auto context = phaseContext<Epoch::Radiation>(t0);
+    return [context](double t) -> double
+    {
+        return context->rhoPhi(t);
+    };
+}
+
+
+EnergyDensityDerivative PhiParticle::energyDensityStiffDerivative()
+{
+    auto context = phaseContext<Epoch::Stiff>(p.t0);
+    return [this, context](double t, double rho) -> double
+    {
+        // rho = e^(-D(t)) / t * integral of t' C(t') e^(D(t')), D the decay rate.
+        return this->creationRate(t) - (1.0 / t + context->decay.derivative(t)) * rho;
+    };
+}
+
+
+EnergyDensityDerivative PhiParticle::energyDensityMatterDerivative(double t0)
+{
+    using Matter = EpochTraits<Epoch::Matter>;
+    auto context = phaseContext<Epoch::Matter>(t0);
+    return [context](double t, double rho) -> double
+    {
+        return -(Matter::a3Exponent / t + context->decay.derivative(t)) * rho;
+    };
+}
+
+
+EnergyDensityDerivative PhiParticle::energyDensityRadiationDerivative(double t0)
+{
+    using Radiation = EpochTraits<Epoch::Radiation>;
+    auto context = phaseContext<Epoch::Radiation>(t0);
+    return [context](double t, double rho) -> double
+    {
+        return -(Radiation::a3Exponent / t + context->decay.derivative(t)) * rho;
+    };
+}
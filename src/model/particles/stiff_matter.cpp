@@ -8,6 +8,14 @@ EnergyDensity StiffMatter::energyDensity()
 {
     return [this](double t) -> double
     {
-        return 1.0 / (24.0 * std::numbers::pi * this->p.G_N * pow(t, 2.0));
+        return 1.0 / (24.0 * std::numbers::pi * this->p.G_N * t * t);
+    };
+};
+
+EnergyDensityDerivative StiffMatter::energyDensityDerivative()
+{
+    return [](double t, double rho) -> double
+    {
+        return -2.0 * rho / t;
     };
 };
\ No newline at end of file
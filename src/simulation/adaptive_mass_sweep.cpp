@@ -0,0 +1,133 @@
+#include <cmath>
+#include <map>
+#include <optional>
+#include <tuple>
+#include <iterator>
+#include <algorithm>
+#include <iostream>
+
+#include "simulation/adaptive_mass_sweep.hpp"
+#include "simulation/simulation_manager.hpp"
+
+
+AdaptiveMassSweep::AdaptiveMassSweep(std::vector<ModelParameters> slices_,
+                                     std::unique_ptr<ResultsWriter> writer_,
+                                     AdaptiveSweepSettings settings_,
+                                     std::size_t workerCount_)
+    : slices{std::move(slices_)},
+      writer{std::move(writer_)},
+      settings{settings_},
+      workerCount{workerCount_}
+    {};
+
+
+std::size_t AdaptiveMassSweep::getSimulationCount() const
+{
+    return simulationCount;
+}
+
+
+std::vector<SimulationResults> AdaptiveMassSweep::runRound(std::vector<ModelParameters> batch)
+{
+    simulationCount += batch.size();
+    return SimulationManager::runBatch(std::move(batch), writer.get(), workerCount, Outputs::Default,
+                                     settings.precision);
+}
+
+
+bool AdaptiveMassSweep::needsRefinement(const SimulationResults& a, const SimulationResults& b) const
+{
+    if (a.toMatter != b.toMatter || a.bothFound != b.bothFound)
+    {
+        return true;
+    }
+
+    double dTemp = std::abs(log10(a.reheating_temp) - log10(b.reheating_temp));
+    double dTime = std::abs(log10(a.t_eq) - log10(b.t_eq));
+    // NaN differences count as a change as well.
+    return !(dTemp <= settings.tolerance && dTime <= settings.tolerance);
+}
+
+
+void AdaptiveMassSweep::run()
+{
+    struct Point
+    {
+        int depth;
+        std::optional<SimulationResults> result;  // Empty if the simulation failed.
+    };
+    // Mass points of every slice ordered by m.
+    std::vector<std::map<double, Point>> points(slices.size());
+
+    std::vector<ModelParameters> batch;
+    std::vector<std::size_t> batchSlice;
+    auto schedule = [&](std::size_t slice, double m, int depth)
+    {
+        ModelParameters p = slices[slice];
+        p.m = m;
+        points[slice][m] = Point{depth, std::nullopt};
+        batch.push_back(p);
+        batchSlice.push_back(slice);
+    };
+
+    // Coarse ladder
+    double step = pow(10.0, 1.0 / settings.coarsePointsPerDecade);
+    for (std::size_t s = 0; s < slices.size(); s++)
+    {
+        for (double m = settings.mMin; m < settings.mMax * (1.0 + 1e-12); m *= step)
+        {
+            schedule(s, m, 0);
+        }
+    }
+
+    while (!batch.empty())
+    {
+        std::cout << "Adaptive sweep round with " << batch.size() << " mass points." << std::endl;
+
+        // Results are matched back to their slice by their parameters.
+        std::map<std::tuple<double, double, double, double>, std::size_t> sliceOf;
+        for (std::size_t i = 0; i < batch.size(); i++)
+        {
+            const auto& p = batch[i];
+            sliceOf[{p.lambda, p.xi, p.b, p.m}] = batchSlice[i];
+        }
+        std::vector<ModelParameters> round;
+        round.swap(batch);
+        batchSlice.clear();
+
+        for (auto& res : runRound(std::move(round)))
+        {
+            const auto& p = res.params;
+            auto it = sliceOf.find({p.lambda, p.xi, p.b, p.m});
+            if (it != sliceOf.end())
+            {
+                points[it->second][p.m].result = res;
+            }
+        }
+
+        // Bisect every interval that is still too coarse.
+        for (std::size_t s = 0; s < points.size(); s++)
+        {
+            std::vector<std::pair<double, int>> midpoints;
+            for (auto left = points[s].begin(), right = std::next(left);
+                 right != points[s].end(); ++left, ++right)
+            {
+                int depth = std::max(left->second.depth, right->second.depth);
+                if (depth >= settings.maxDepth || !left->second.result || !right->second.result)
+                {
+                    continue;
+                }
+
+                if (needsRefinement(*left->second.result, *right->second.result))
+                {
+                    midpoints.emplace_back(sqrt(left->first * right->first), depth + 1);
+                }
+            }
+
+            for (auto [m, depth] : midpoints)
+            {
+                schedule(s, m, depth);
+            }
+        }
+    }
+}
@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+#include <utility>
+#include <boost/math/special_functions/gamma.hpp>
+#include <boost/math/tools/roots.hpp>
+
+#include "model/epoch.hpp"
+#include "simulation/analytic_estimate.hpp"
+#include "solvers/equal_time_solver.hpp"
+
+
+namespace
+{
+
+/**
+ * e^xs times the integral of (y - xs) y^q e^(-y) over [xs, x]. With x = Gamma t, this is the
+ * time integral of the chi source of a phase started at xs = Gamma t_s, up to powers of Gamma.
+ */
+double sourceIntegral(double q, double xs, double x)
+{
+    using boost::math::tgamma;
+    using boost::math::tgamma_lower;
+
+    if (xs > 500)
+    {
+        // e^xs overflows below; expand (xs + v)^q in v / xs instead, v = y - xs.
+        double v = x - xs;
+        return std::pow(xs, q) * (tgamma_lower(2.0, v) + q / xs * tgamma_lower(3.0, v)
+                                  + q * (q - 1) / (2 * xs * xs) * tgamma_lower(4.0, v));
+    }
+    // Integral of y^(a - 1) e^(-y) over [xs, x], from the lower incomplete gamma function
+    // while it is far from its limit Gamma(a) and from the upper one after that.
+    auto increment = [&](double a)
+    {
+        return (xs < 1) ? tgamma_lower(a, x) - tgamma_lower(a, xs) : tgamma(a, xs) - tgamma(a, x);
+    };
+    return std::exp(xs) * (increment(q + 2) - xs * increment(q + 1));
+}
+
+
+/**
+ * Matter or radiation phase from tStart with the decay rate gamma (t - tStart):
+ * rho_phi = phi0 (tStart / t)^a3Exponent e^(-gamma (t - tStart)), and rho_chi the integral of
+ * the rate times rho_phi a^4 over a^4, plus chi0 diluted, as in ChiParticle.
+ */
+template<Epoch E>
+struct DecayPhase
+{
+    using Traits = EpochTraits<E>;
+    static constexpr double q = Traits::a4Exponent - Traits::a3Exponent;
+
+    double gamma;
+    double tStart;
+    double phi0;
+    double chi0;
+
+    double rhoPhi(double t) const
+    {
+        return phi0 * std::pow(tStart / t, Traits::a3Exponent) * std::exp(-gamma * (t - tStart));
+    }
+
+    // Integral of rate * rho_phi * a^4 / t^k from tStart to t.
+    double source(double t, double k = 0.0) const
+    {
+        return phi0 * std::pow(tStart, Traits::a3Exponent) * std::pow(gamma, k - q - 1)
+             * sourceIntegral(q - k, gamma * tStart, gamma * t);
+    }
+
+    double rhoChi(double t) const
+    {
+        return (source(t) + chi0 * std::pow(tStart, Traits::a4Exponent)) / std::pow(t, Traits::a4Exponent);
+    }
+};
+
+
+/**
+ * Time of the maximum of rho_chi on [tStart, 1e5 tStart] and the integral of rho_chi up to it,
+ * searched like ChiParticle::radiationPeak, so that a maximum at an end of the range is
+ * reported there as well.
+ */
+std::pair<double, double> radiationPeak(const DecayPhase<Epoch::Radiation>& phase)
+{
+    constexpr int panels = 50;      // 10 per decade
+    const double t0 = phase.tStart;
+    auto time = [&](int i) {return t0 * std::pow(1e5, double(i) / panels);};
+
+    int peak = 0;
+    double rhoPeak = phase.chi0;
+    for (int i = 1; i <= panels; i++)
+    {
+        double rho = phase.rhoChi(time(i));
+        if (rho > rhoPeak)
+        {
+            peak = i;
+            rhoPeak = rho;
+        }
+    }
+    // d(rho_chi)/dt = 0
+    auto slope = [&](double t)
+    {
+        return phase.gamma * (t - t0) * phase.rhoPhi(t) * t - 2.0 * phase.rhoChi(t);
+    };
+    double tPeak = time(peak);
+    if (peak > 0 && peak < panels)
+    {
+        double tLow = time(peak - 1);
+        double tHigh = time(peak + 1);
+        double fLow = slope(tLow);
+        double fHigh = slope(tHigh);
+        if (fLow > 0 && fHigh < 0)
+        {
+            const int digits = std::numeric_limits<double>::digits - 10;
+            std::uintmax_t maxIter = 100;
+            auto root = boost::math::tools::toms748_solve(slope, tLow, tHigh, fLow, fHigh,
+                boost::math::tools::eps_tolerance<double>(digits), maxIter);
+            tPeak = (root.first + root.second) / 2.0;
+        }
+    }
+
+    // Integral of (I + C) / t^2 by parts, I the source integral.
+    const double C = phase.chi0 * t0 * t0;
+    double integral = C / t0 - (phase.source(tPeak) + C) / tPeak + phase.source(tPeak, 1.0);
+    return {tPeak, integral};
+}
+
+}
+
+
+AnalyticEstimate::AnalyticEstimate(const ModelParameters& p_) : p{p_}
+{
+    using std::numbers::pi;
+    double mb = p.m * p.b;
+    K = 3.0 * std::pow(mb, 13.0 / 3.0) / (32.0 * pi * p.b) * std::cbrt(2.0 / (3.0 * p.m));
+    gamma = 0.0;
+    for (const auto& channel : p.decayChannels())
+    {
+        gamma += channel.lambda * channel.lambda / (16.0 * pi * p.m);
+    }
+    S = 1.0 / (24.0 * pi * p.G_N);
+}
+
+
+std::optional<SimulationResults> AnalyticEstimate::run() const
+{
+    // The results of several channels include rho_chi per channel.
+    if (p.decayChannels().size() != 1)
+    {
+        return std::nullopt;
+    }
+
+    // Stiff phase, rho_phi = e^(-Gamma t) / t * integral of K t'^(5/3) e^(Gamma t'), in the
+    // limits Gamma t << 1 and Gamma t >> 1 (quasi-equilibrium rho_phi = C / Gamma).
+    auto rhoPhi = [&](double t)
+    {
+        return (gamma * t <= 1) ? 3.0 / 8.0 * K * t * std::cbrt(t * t) : K * std::cbrt(t * t) / gamma;
+    };
+    auto rhoChi = [&](double t)
+    {
+        return (gamma * t <= 1) ? 3.0 / 40.0 * gamma * K * t * t * t * std::cbrt(t * t)
+                                : K * t * t * std::cbrt(t * t) / 4.0;
+    };
+    // Relative error of both at t. The first-order terms in Gamma t are bounded with a
+    // margin of two, which the crossover Gamma t ~ 1 needs.
+    auto stiffError = [&](double t)
+    {
+        double x = gamma * t;
+        return 2.0 * std::min(x, 1.0 / x) + 1.0 / (p.m * t) + std::pow(p.t0 / t, 8.0 / 3.0);
+    };
+    // Time at which c t^k reaches the stiff density S / t^2, for the (c, k) of the limit
+    // Gamma t << 1 or of Gamma t >> 1, and its relative error.
+    auto crossing = [&](double cSmall, double kSmall, double cLarge, double kLarge)
+    {
+        double t = std::pow(S / cSmall, 1.0 / (kSmall + 2));
+        double slope = kSmall + 2;
+        if (gamma * t > 1)
+        {
+            t = std::pow(S / cLarge, 1.0 / (kLarge + 2));
+            slope = kLarge + 2;
+        }
+        return std::pair{t, stiffError(t) / slope};
+    };
+    auto [tPhi, phiError] = crossing(3.0 / 8.0 * K, 5.0 / 3.0, K / gamma, 2.0 / 3.0);
+    auto [tChi, chiError] = crossing(3.0 / 40.0 * gamma * K, 11.0 / 3.0, K / 4.0, 8.0 / 3.0);
+
+    // Near the toMatter boundary the order of the equalities is uncertain.
+    if (!(std::abs(std::log(tChi / tPhi)) > phiError + chiError))
+    {
+        return std::nullopt;
+    }
+    const bool toMatter = tPhi < tChi;
+    const double t_eq = toMatter ? tPhi : tChi;
+    if (!(t_eq > p.t0))
+    {
+        return std::nullopt;
+    }
+
+    SimulationResults res;
+    res.params = p;
+    res.approximate = true;
+    res.t_eq = t_eq;
+    res.rhoStiff_t_eq = S / (t_eq * t_eq);
+    res.toMatter = toMatter;
+    res.bothFound = true;
+
+    double error = toMatter ? phiError : chiError;
+    // Densities at t_eq: their own error and that of t_eq along log-slopes below 4.
+    double initialError = stiffError(t_eq) + 4.0 * error;
+    double radiationStart = t_eq;
+    double phi0 = rhoPhi(t_eq);
+    double chi0 = rhoChi(t_eq);
+
+    if (toMatter)
+    {
+        res.rhoPhiStiff_t_eq = phi0;
+        res.rhoChi_t_eq = chi0;
+
+        using Matter = EpochTraits<Epoch::Matter>;
+        DecayPhase<Epoch::Matter> matter{gamma, t_eq, phi0, chi0};
+        EqualTime equality = EqualTimeSolver(
+            [&](double t) {return matter.rhoPhi(t);},
+            [&](double t, double rho) {return -(Matter::a3Exponent / t + gamma) * rho;},
+            [&](double t) {return matter.rhoChi(t);},
+            [&](double t, double rho) {return gamma * (t - t_eq) * matter.rhoPhi(t) - Matter::a4Exponent * rho / t;},
+            t_eq).solve();
+        if (!equality.found())
+        {
+            return std::nullopt;
+        }
+        res.tau_eq = equality.t;
+        res.rhoPhiMatEq = equality.rho1;
+        res.rhoChiMatEq = equality.rho2;
+        res.multipleCrossings = equality.crossings > 1;
+
+        double tauError = initialError + 1.0 / (p.m * t_eq);
+        error = std::max(error, tauError);
+        initialError += 3.0 * tauError;
+        radiationStart = equality.t;
+        phi0 = equality.rho1;
+        chi0 = equality.rho2;
+    }
+    else
+    {
+        res.rhoPhiStiff_t_eq = 0;
+        res.rhoChi_t_eq = chi0;
+        res.tau_eq = 0;
+        res.rhoPhiMatEq = 0;
+        res.rhoChiMatEq = 0;
+    }
+
+    auto [t_rh, integral] = radiationPeak(DecayPhase<Epoch::Radiation>{gamma, radiationStart, phi0, chi0});
+    res.reheating_time = t_rh;
+    res.reheating_temp = std::pow(integral, 0.25);
+    // T_RH is the fourth root of an integral linear in the initial densities.
+    double reheatingError = (initialError + 1.0 / (p.m * radiationStart)) / 4.0;
+    res.approximationError = std::max(error, reheatingError);
+
+    if (!std::isfinite(res.reheating_temp) || !std::isfinite(res.approximationError))
+    {
+        return std::nullopt;
+    }
+    return res;
+}
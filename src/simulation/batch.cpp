@@ -0,0 +1,72 @@
+#include <deque>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+
+#include "simulation/batch.hpp"
+#include "simulation/simulation_manager.hpp"
+
+
+namespace
+{
+
+// Places every result into the slot of its parameter set.
+class SlotWriter : public ResultsWriter
+{
+    private:
+        std::span<SimulationResults> results;
+        std::map<ModelParameters, std::deque<std::size_t>> slots;
+        const std::function<void(std::size_t, std::size_t)>& progress;
+        std::size_t done = 0;
+        std::mutex mtx;
+
+    public:
+        SlotWriter(std::span<const ModelParameters> params, std::span<SimulationResults> results_,
+                   const std::function<void(std::size_t, std::size_t)>& progress_)
+            : results{results_}, progress{progress_}
+        {
+            for (std::size_t i = 0; i < params.size(); i++)
+            {
+                slots[params[i]].push_back(i);
+            }
+        }
+
+        void write(const SimulationResults& res) override
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto& free = slots.at(res.params);
+            results[free.front()] = res;
+            free.pop_front();
+
+            if (progress)
+            {
+                progress(++done, results.size());
+            }
+        }
+};
+
+}
+
+
+void simulateBatch(std::span<const ModelParameters> params,
+                   std::span<SimulationResults> results,
+                   const BatchOptions& options)
+{
+    if (params.size() != results.size())
+    {
+        throw std::invalid_argument("simulateBatch: params and results differ in size");
+    }
+    if (params.empty())
+    {
+        return;
+    }
+
+    auto writer = std::make_unique<SlotWriter>(params, results, options.progress);
+    SimulationManager manager({params.begin(), params.end()}, std::move(writer),
+                              options.threads, options.outputs);
+    manager.setProgressOutput(false);
+    manager.setBudget(options.budget);
+    manager.setPrecision(options.precision);
+    manager.setResultStore(options.store);
+    manager.run();
+}
@@ -0,0 +1,157 @@
+#include <cmath>
+#include <iostream>
+#include <limits>
+
+#include "simulation/inverse_reheating_solver.hpp"
+
+
+InverseReheatingSolver::InverseReheatingSolver(const ModelParameters& slice_, InverseSolverSettings settings_)
+    : slice{slice_}, settings{settings_}, simulation{[&] {ModelParameters p = slice_; p.m = settings_.mMin; return p;}()}
+{
+    // T_RH depends on the equality times about linearly; a tenth of the tolerance for both
+    // keeps the simulated values from deciding the convergence.
+    double precision = settings.temperatureTolerance / 10.0;
+    simulation.setPrecision(PrecisionTargets{.equalityTime = precision, .reheatingTemp = precision});
+
+    double step = pow(10.0, 1.0 / settings.scanPointsPerDecade);
+    for (double m = settings.mMin; m < settings.mMax * (1.0 + 1e-12); m *= step)
+    {
+        scan.push_back(m);
+    }
+}
+
+
+std::size_t InverseReheatingSolver::getSimulationCount() const
+{
+    return simulationCount;
+}
+
+
+const InverseReheatingSolver::Evaluation& InverseReheatingSolver::evaluate(double m)
+{
+    auto found = evaluations.find(m);
+    if (found != evaluations.end())
+    {
+        return found->second;
+    }
+
+    ModelParameters p = slice;
+    p.m = m;
+    Evaluation evaluation{false, SimulationResults::notComputed, false};
+    try
+    {
+        BudgetGuard guard(settings.budget);
+        simulation.rebind(p);
+        SimulationResults res = simulation.run(Outputs::Default);
+        evaluation = {res.status == SimulationStatus::Ok && std::isfinite(res.reheating_temp),
+                      res.reheating_temp, res.toMatter};
+    }
+    catch (const std::exception& ex)
+    {
+        std::cerr << "Inverse solve at m = " << m << ": " << ex.what() << "\n";
+    }
+    simulationCount++;
+    return evaluations.emplace(m, evaluation).first->second;
+}
+
+
+/**
+ * Illinois method on log T_RH - log target in log m: secant steps in which an end that is
+ * kept twice in a row has its value halved, so that neither end can stall. A jump at the
+ * toMatter switch is approached by the bisection steps.
+ */
+InverseSolution InverseReheatingSolver::refine(double mLow, double mHigh, double target)
+{
+    auto g = [&](const Evaluation& e) {return log(e.reheatingTemp) - log(target);};
+    const double temperatureTolerance = log1p(settings.temperatureTolerance);
+    const double massTolerance = log1p(settings.massTolerance);
+
+    double a = log(mLow);
+    double b = log(mHigh);
+    Evaluation ea = evaluate(mLow);
+    Evaluation eb = evaluate(mHigh);
+    double fa = g(ea);
+    double fb = g(eb);
+    double wa = fa;         // Values used by the secant, halved by the Illinois rule
+    double wb = fb;
+    int kept = 0;           // -1 if a was kept by the last step, +1 if b was
+    // Widths of the bracket before the last two steps.
+    double widths[2] = {std::numeric_limits<double>::infinity(), std::numeric_limits<double>::infinity()};
+    bool converged = false;
+
+    for (int i = 0; i < settings.maxIterations; i++)
+    {
+        if (std::min(std::abs(fa), std::abs(fb)) <= temperatureTolerance || b - a <= massTolerance)
+        {
+            converged = true;
+            break;
+        }
+
+        double c = (wa * b - wb * a) / (wa - wb);
+        if (!(c > a && c < b) || b - a > widths[1] / 2)
+        {
+            c = (a + b) / 2;
+        }
+        widths[1] = widths[0];
+        widths[0] = b - a;
+
+        Evaluation ec = evaluate(exp(c));
+        if (!ec.ok)
+        {
+            break;
+        }
+        double fc = g(ec);
+        if ((fc < 0) == (fa < 0))
+        {
+            a = c;
+            ea = ec;
+            fa = wa = fc;
+            wb = (kept == 1) ? wb / 2 : wb;
+            kept = 1;
+        }
+        else
+        {
+            b = c;
+            eb = ec;
+            fb = wb = fc;
+            wa = (kept == -1) ? wa / 2 : wa;
+            kept = -1;
+        }
+    }
+
+    // The simulated end nearer to the target.
+    bool lowBetter = std::abs(fa) <= std::abs(fb);
+    const Evaluation& best = lowBetter ? ea : eb;
+
+    InverseSolution solution;
+    solution.params = slice;
+    solution.params.m = exp(lowBetter ? a : b);
+    solution.mLow = exp(a);
+    solution.mHigh = exp(b);
+    solution.reheatingTemp = best.reheatingTemp;
+    solution.temperatureError = std::abs(best.reheatingTemp / target - 1.0);
+    solution.toMatter = best.toMatter;
+    solution.atSwitch = ea.toMatter != eb.toMatter && std::abs(lowBetter ? fa : fb) > temperatureTolerance;
+    solution.converged = converged;
+    return solution;
+}
+
+
+std::vector<InverseSolution> InverseReheatingSolver::solve(double targetTemperature)
+{
+    std::vector<InverseSolution> solutions;
+    for (std::size_t i = 0; i + 1 < scan.size(); i++)
+    {
+        const Evaluation& low = evaluate(scan[i]);
+        const Evaluation& high = evaluate(scan[i + 1]);
+        if (!low.ok || !high.ok)
+        {
+            continue;  // Failed simulation, no information
+        }
+        if ((low.reheatingTemp < targetTemperature) != (high.reheatingTemp < targetTemperature))
+        {
+            solutions.push_back(refine(scan[i], scan[i + 1], targetTemperature));
+        }
+    }
+    return solutions;
+}
@@ -0,0 +1,148 @@
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <iostream>
+
+#include "simulation/phase_boundary_tracer.hpp"
+#include "simulation/simulation_manager.hpp"
+
+
+using ParameterKey = std::tuple<double, double, double, double>;
+
+static ParameterKey keyOf(const ModelParameters& p)
+{
+    return {p.lambda, p.xi, p.b, p.m};
+}
+
+
+PhaseBoundaryTracer::PhaseBoundaryTracer(std::vector<ModelParameters> slices_,
+                                         BoundaryTracerSettings settings_,
+                                         std::size_t workerCount_)
+    : slices{std::move(slices_)},
+      settings{settings_},
+      workerCount{workerCount_}
+    {};
+
+
+std::size_t PhaseBoundaryTracer::getSimulationCount() const
+{
+    return simulationCount;
+}
+
+
+std::vector<SimulationResults> PhaseBoundaryTracer::runRound(std::vector<ModelParameters> batch)
+{
+    std::cout << "Boundary tracing round with " << batch.size() << " points." << std::endl;
+    simulationCount += batch.size();
+    // Only the stiff phase decides toMatter.
+    return SimulationManager::runBatch(std::move(batch), nullptr, workerCount, Outputs::StiffEquality,
+                                     settings.precision);
+}
+
+
+std::vector<BoundaryPoint> PhaseBoundaryTracer::run()
+{
+    // Scan: toMatter on a coarse ladder for every slice.
+    std::vector<ModelParameters> batch;
+    double step = pow(10.0, 1.0 / settings.scanPointsPerDecade);
+    for (const auto& slice : slices)
+    {
+        for (double m = settings.mMin; m < settings.mMax * (1.0 + 1e-12); m *= step)
+        {
+            ModelParameters p = slice;
+            p.m = m;
+            batch.push_back(p);
+        }
+    }
+
+    std::map<ParameterKey, bool> toMatter;
+    for (const auto& res : runRound(batch))
+    {
+        toMatter[keyOf(res.params)] = res.toMatter;
+    }
+
+    // Brackets between neighbouring scan points that disagree.
+    std::vector<BoundaryPoint> brackets;
+    for (std::size_t i = 0; i + 1 < batch.size(); i++)
+    {
+        const auto& low = batch[i];
+        const auto& high = batch[i + 1];
+        if (low.lambda != high.lambda || low.xi != high.xi || low.b != high.b)
+        {
+            continue;  // Next slice
+        }
+
+        auto flagLow = toMatter.find(keyOf(low));
+        auto flagHigh = toMatter.find(keyOf(high));
+        if (flagLow == toMatter.end() || flagHigh == toMatter.end())
+        {
+            continue;  // Failed simulation, no information
+        }
+
+        if (flagLow->second != flagHigh->second)
+        {
+            brackets.push_back({low, low.m, high.m, flagLow->second, true});
+        }
+    }
+
+    // Bisect all open brackets together.
+    auto isOpen = [&](const BoundaryPoint& b)
+    {
+        return b.converged && b.mHigh / b.mLow - 1.0 > settings.tolerance;
+    };
+
+    while (true)
+    {
+        batch.clear();
+        for (const auto& bracket : brackets)
+        {
+            if (isOpen(bracket))
+            {
+                ModelParameters p = bracket.params;
+                p.m = sqrt(bracket.mLow * bracket.mHigh);
+                batch.push_back(p);
+            }
+        }
+
+        if (batch.empty())
+        {
+            break;
+        }
+
+        toMatter.clear();
+        for (const auto& res : runRound(batch))
+        {
+            toMatter[keyOf(res.params)] = res.toMatter;
+        }
+
+        for (auto& bracket : brackets)
+        {
+            if (!isOpen(bracket))
+            {
+                continue;
+            }
+
+            ModelParameters p = bracket.params;
+            p.m = sqrt(bracket.mLow * bracket.mHigh);
+            auto flag = toMatter.find(keyOf(p));
+            if (flag == toMatter.end())
+            {
+                bracket.converged = false;
+            }
+            else if (flag->second == bracket.toMatterBelow)
+            {
+                bracket.mLow = p.m;
+            }
+            else
+            {
+                bracket.mHigh = p.m;
+            }
+        }
+    }
+
+    for (auto& bracket : brackets)
+    {
+        bracket.params.m = sqrt(bracket.mLow * bracket.mHigh);
+    }
+    return brackets;
+}
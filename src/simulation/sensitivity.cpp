@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numbers>
+#include <stdexcept>
+
+#include "model/energy/creation_decay.hpp"
+#include "model/epoch.hpp"
+#include "model/particles/phase_densities.hpp"
+#include "simulation/sensitivity.hpp"
+#include "utils/dual.hpp"
+#include "utils/integration.hpp"
+
+
+namespace
+{
+
+constexpr std::size_t variables = 4;                // m, lambda, b, xi
+constexpr std::size_t timeDirection = variables;    // d/dt at a root
+using Real = Dual<variables + 1>;
+
+
+/**
+ * Integral of f over [a, b] with dual limits, written as an integral over s in [0, 1] of
+ * f(a + s (b - a)) (b - a), or of f(a (b / a)^s) t log(b / a) on a log scale, so that the
+ * derivatives of the limits enter through the nodes. Each of the equal panels in s is
+ * integrated by IntegrationUtils::integrateLeading to within the budget of the values, which
+ * the derivatives follow.
+ */
+template<std::size_t M, typename F>
+std::array<Real, M> integrateDual(F&& f, const Real& a, const Real& b,
+                                  const IntegrationUtils::ErrorBudget& budget, bool logScale = false,
+                                  int panels = 1)
+{
+    constexpr std::size_t directions = variables + 1;
+    constexpr std::size_t width = M * (directions + 1);
+    const Real span = logScale ? log(b / a) : b - a;
+
+    // The M values first, then the derivatives of each.
+    auto components = [&](double s) -> std::array<double, width>
+    {
+        Real t = logScale ? a * exp(span * s) : a + span * s;
+        std::array<Real, M> values = f(t);
+        std::array<double, width> flat;
+        for (std::size_t k = 0; k < M; k++)
+        {
+            Real v = logScale ? values[k] * t : values[k];
+            flat[k] = v.value;
+            std::copy(v.grad.begin(), v.grad.end(), flat.begin() + M + k * directions);
+        }
+        return flat;
+    };
+
+    std::array<double, width> sum{};
+    for (int i = 0; i < panels; i++)
+    {
+        auto panel = IntegrationUtils::integrateLeading<M, width>(
+            components, double(i) / panels, double(i + 1) / panels, budget);
+        for (std::size_t k = 0; k < width; k++)
+        {
+            sum[k] += panel[k];
+        }
+    }
+
+    std::array<Real, M> result;
+    for (std::size_t k = 0; k < M; k++)
+    {
+        result[k].value = sum[k];
+        std::copy(sum.begin() + M + k * directions, sum.begin() + M + (k + 1) * directions,
+                  result[k].grad.begin());
+        result[k] *= span;
+    }
+    return result;
+}
+
+/**
+ * Integral of a density from the start of its phase, split as IntegrationUtils::integrate
+ * splits it: over more than two decades the last two on a linear scale and everything below
+ * on a log scale, each with half of the budget.
+ */
+template<typename F>
+Real integrateDensity(F&& f, const Real& a, const Real& b, const IntegrationUtils::ErrorBudget& budget)
+{
+    auto single = [&f](const Real& t) -> std::array<Real, 1> {return {f(t)};};
+    if (!(a.value > 0.0 && b.value > 100.0 * a.value))
+    {
+        return integrateDual<1>(single, a, b, budget)[0];
+    }
+    // The split point cancels from the derivatives of the sum.
+    const Real linearStart = b / 100.0;
+    return integrateDual<1>(single, a, linearStart, budget.half(), true)[0]
+           + integrateDual<1>(single, linearStart, b, budget.half())[0];
+}
+
+
+// Decay rate of the single channel in the epoch with index n, starting at t0.
+class DecayRate
+{
+    private:
+        Real couplingSquared;
+        Real m;
+        Real alpha;
+        Real initial;
+    public:
+        DecayRate(const Real& m_, const Real& lambda, const Real& xi, double n, const Real& t0)
+            : couplingSquared{lambda * lambda},
+              m{m_},
+              alpha{ModelParameters::alpha(n, xi)},
+              initial{decayBesselTerm(m, alpha, t0)}
+            {};
+
+        Real operator()(const Real& t) const
+        {
+            return couplingSquared * (decayBesselTerm(m, alpha, t) - initial);
+        }
+};
+
+
+// Root of h at t: value t, derivatives -h_theta / h_t.
+Real implicitRoot(const Real& h, double t)
+{
+    Real root(t);
+    for (std::size_t i = 0; i < variables; i++)
+    {
+        root.grad[i] = -h.grad[i] / h.grad[timeDirection];
+    }
+    return root;
+}
+
+// q evaluated at a time seeded in timeDirection, moved onto the root t(theta).
+Real atRoot(Real q, const Real& root)
+{
+    for (std::size_t i = 0; i < variables; i++)
+    {
+        q.grad[i] += q.grad[timeDirection] * root.grad[i];
+    }
+    q.grad[timeDirection] = 0.0;
+    return q;
+}
+
+Gradient gradientOf(const Real& q)
+{
+    Gradient g;
+    std::copy(q.grad.begin(), q.grad.begin() + variables, g.begin());
+    return g;
+}
+
+}
+
+
+void SensitivityAnalysis::apply(SimulationResults& res) const
+{
+    if (!p.channels.empty())
+    {
+        throw std::invalid_argument("Sensitivities are only available for a single decay channel");
+    }
+
+    using Stiff = EpochTraits<Epoch::Stiff>;
+    using Matter = EpochTraits<Epoch::Matter>;
+    using Radiation = EpochTraits<Epoch::Radiation>;
+
+    const Real m = Real::variable(p.m, 0);
+    const Real lambda = Real::variable(p.lambda, 1);
+    const Real b = Real::variable(p.b, 2);
+    const Real xi = Real::variable(p.xi, 3);
+    const Real t0(p.t0);
+    // As Simulation::setPrecision divides it between the particles.
+    const IntegrationUtils::ErrorBudget particleBudget = densityBudget.half();
+
+    // Stiff phase, as PhiParticle::energyDensityStiff and ChiParticle::energyDensityStiff.
+    DecayRate stiffDecay(m, lambda, xi, Stiff::n, t0);
+    auto rhoPhiStiff = [&](const Real& t) -> Real
+    {
+        Real decayT = stiffDecay(t);
+        Real integral = integrateDensity([&](const Real& x)
+        {
+            return stiffPhiIntegrand(x, PhiCreationRate(m, b, x), stiffDecay(x) - decayT);
+        }, t0, t, particleBudget);
+        return stiffPhiDensity(integral, t);
+    };
+    auto rhoChiStiff = [&](const Real& t) -> Real
+    {
+        Real integral = integrateDensity([&](const Real& x)
+        {
+            return chiSource<Epoch::Stiff>(stiffDecay(x), rhoPhiStiff(x), x);
+        }, t0, t, particleBudget);
+        return chiDensity<Epoch::Stiff>(integral, t0, t, Real(0.0));
+    };
+
+    Real tStiff = Real::variable(res.t_eq, timeDirection);
+    Real phiStiff = rhoPhiStiff(tStiff);
+    Real chiStiff = rhoChiStiff(tStiff);
+    Real rhoStiff = 1.0 / (24.0 * std::numbers::pi * p.G_N * tStiff * tStiff);
+    Real t_eq = implicitRoot(log(rhoStiff) - log(res.toMatter ? phiStiff : chiStiff), res.t_eq);
+    res.dt_eq = gradientOf(t_eq);
+
+    // Matter phase, starting from the stiff densities at t_eq.
+    Real radiationStart = t_eq;
+    Real phiStart = atRoot(phiStiff, t_eq);
+    Real chiStart = atRoot(chiStiff, t_eq);
+    if (res.toMatter)
+    {
+        DecayRate matterDecay(m, lambda, xi, Matter::n, t_eq);
+        auto rhoPhiMatter = [&](const Real& t) -> Real
+        {
+            return decayedPhiDensity<Epoch::Matter>(t_eq, t, matterDecay(t), phiStart);
+        };
+        auto rhoChiMatter = [&](const Real& t) -> Real
+        {
+            Real integral = integrateDensity([&](const Real& x)
+            {
+                Real decay = matterDecay(x);
+                return chiSource<Epoch::Matter>(decay, decayedPhiDensity<Epoch::Matter>(t_eq, x, decay, phiStart), x);
+            }, t_eq, t, particleBudget);
+            return chiDensity<Epoch::Matter>(integral, t_eq, t, chiStart);
+        };
+
+        Real tMatter = Real::variable(res.tau_eq, timeDirection);
+        Real phiMatter = rhoPhiMatter(tMatter);
+        Real chiMatter = rhoChiMatter(tMatter);
+        Real tau_eq = implicitRoot(log(phiMatter) - log(chiMatter), res.tau_eq);
+        res.dtau_eq = gradientOf(tau_eq);
+
+        radiationStart = tau_eq;
+        phiStart = atRoot(phiMatter, tau_eq);
+        chiStart = atRoot(chiMatter, tau_eq);
+    }
+    else
+    {
+        res.dtau_eq = {0.0, 0.0, 0.0, 0.0};  // tau_eq is reported as 0 without a matter phase.
+    }
+
+    // Radiation phase, as ChiParticle::radiationPeak: rho_chi = (I + C) / t^2 with I the
+    // integral of the source, and the integral of rho_chi up to the peak by parts.
+    const Real& tr = radiationStart;
+    DecayRate radiationDecay(m, lambda, xi, Radiation::n, tr);
+    auto source = [&](const Real& t) -> Real
+    {
+        Real decay = radiationDecay(t);
+        return chiSource<Epoch::Radiation>(decay, decayedPhiDensity<Epoch::Radiation>(tr, t, decay, phiStart), t);
+    };
+    const Real C = chiStart * tr * tr;
+
+    double tPeak = res.reheating_time;
+    Real tSeeded = Real::variable(tPeak, timeDirection);
+    int panels = std::max(1, static_cast<int>(std::ceil(10.0 * log10(tPeak / tr.value))));
+    auto [I, J] = integrateDual<2>([&](const Real& x) -> std::array<Real, 2>
+    {
+        Real s = source(x);
+        return {s, s / x};
+    }, tr, tSeeded, peakBudget, true, panels);
+
+    // An interior peak is the root of t source(t) = 2 (I + C); a peak on a panel node of
+    // the sweep is a fixed multiple of the start time.
+    Real slope = tSeeded * source(tSeeded) - 2.0 * (I + C);
+    double scale = std::abs(tPeak * source(tSeeded).value) + 2.0 * std::abs(I.value + C.value);
+    Real peak = (std::abs(slope.value) <= 1e-6 * scale) ? implicitRoot(slope, tPeak)
+                                                         : tr * (tPeak / tr.value);
+    I = atRoot(I, peak);
+    J = atRoot(J, peak);
+
+    Real integral = radiationChiIntegral(I, J, C, tr, peak);
+    res.dReheatingTemp = gradientOf(pow(integral, 0.25));
+    res.dReheatingTime = gradientOf(peak);
+}
@@ -4,58 +4,179 @@
 #include "model/particles/stiff_matter.hpp"
 #include "solvers/equal_time_solver.hpp"
 #include "simulation/simulation.hpp"
+#include "simulation/sensitivity.hpp"
 #include "parameters/parameters.hpp"
-#include "utils/maximization.hpp"
-#include "utils/integration.hpp"
 
 
-Simulation::Simulation(const ModelParameters& p_) :
+const char* statusName(SimulationStatus status)
+{
+    switch (status)
+    {
+        case SimulationStatus::Ok: return "ok";
+        case SimulationStatus::OverBudget: return "over_budget";
+        case SimulationStatus::Failed: return "failed";
+        case SimulationStatus::NoStiffEquality: return "no_stiff_equality";
+        case SimulationStatus::NoMatterEquality: return "no_matter_equality";
+        case SimulationStatus::NonFinite: return "non_finite";
+        case SimulationStatus::NotConverged: return "not_converged";
+    }
+    return "unknown";
+}
+
+
+namespace
+{
+
+// Status of a run whose equality search ended with status; noRoot if there was no bracket.
+SimulationStatus statusOf(RootStatus status, SimulationStatus noRoot)
+{
+    switch (status)
+    {
+        case RootStatus::Found: return SimulationStatus::Ok;
+        case RootStatus::NoBracket: return noRoot;
+        case RootStatus::NonFinite: return SimulationStatus::NonFinite;
+        case RootStatus::NotConverged: return SimulationStatus::NotConverged;
+    }
+    return SimulationStatus::Failed;
+}
+
+}
+
+
+Simulation::Simulation(const ModelParameters& p_, std::pmr::memory_resource* resource) :
     p{p_},
-    phi{std::make_shared<PhiParticle>(p_)},
-    chi{ChiParticle(p_, phi)},
+    phi{std::allocate_shared<PhiParticle>(std::pmr::polymorphic_allocator<PhiParticle>(resource), p_, resource)},
+    chi{ChiParticle(p_, phi, resource)},
     stiff{StiffMatter(p_)}
-    {};
+{
+    setPrecision(PrecisionTargets{});
+}
 
 
-SimulationResults Simulation::run()
+void Simulation::setPrecision(const PrecisionTargets& targets)
 {
+    // A relative density error moves an equality by about as much, as the log-slopes of the
+    // density ratios at the equalities are of order one. rho_chi integrates rho_phi, whose
+    // error enters linearly, so the two quadratures share the budget.
+    densityBudget = IntegrationUtils::ErrorBudget{.relative = targets.equalityTime};
+    phi->setErrorBudget(densityBudget.half());
+    chi.setErrorBudget(densityBudget.half());
+    // T_RH is the fourth root of the peak. Half of the budget is left for the errors of the
+    // initial densities of the radiation phase.
+    reheatingTolerance = 2.0 * targets.reheatingTemp;
+}
+
+
+void Simulation::rebind(const ModelParameters& p_)
+{
+    p = p_;
+    phi->rebind(p_);
+    chi.rebind(p_);
+    stiff.rebind(p_);
+}
+
+
+SimulationResults Simulation::run(unsigned outputs)
+{
+    if (outputs & Outputs::Sensitivities)
+    {
+        outputs |= Outputs::Default;
+    }
+
     // Return time of equality and energy densities of stiff matter and that particle
     // (massive phi or massles chi) depending on which one reaches equality first.
-    auto [toMatter, t_eq, rhoStiffEq, rhoEq, bothFound] = runStiffPhase();
+    auto [status, toMatter, t_eq, rhoStiffEq, rhoEq, bothFound, stiffError, stiffMultipleCrossings] = runStiffPhase();
+
+    SimulationResults res;
+    res.params = p;
+    res.status = status;
+    if (status != SimulationStatus::Ok)
+    {
+        return res;
+    }
+    res.t_eq = t_eq;
+    res.rhoStiff_t_eq = rhoStiffEq;
+    res.toMatter = toMatter;
+    res.bothFound = bothFound;
+    res.t_eqQuadratureError = stiffError;
+    res.multipleCrossings = stiffMultipleCrossings;
+
+    // Chi energy density of each decay channel, only needed with several channels.
+    std::size_t channels = chi.channelCount();
+    if (channels > 1)
+    {
+        for (std::size_t c = 0; c < channels; c++)
+        {
+            res.rhoChiChannels_t_eq.push_back(chi.energyDensityStiff(c)(t_eq));
+        }
+    }
+
+    const bool radiationNeeded = outputs & (Outputs::Reheating | Outputs::RadiationEquality);
+    // Start of the radiation phase: tau_eq after a matter phase, t_eq otherwise.
+    double radiationStart;
 
     if (toMatter)
     {
         // Set the initial values
         EnergyDensity rhoChiStiff = chi.energyDensityStiff();
         double rhoChiEq = rhoChiStiff(t_eq);
+        res.rhoPhiStiff_t_eq = rhoEq;
+        res.rhoChi_t_eq = rhoChiEq;
+
+        if (!radiationNeeded && !(outputs & Outputs::MatterEquality))
+        {
+            return res;
+        }
+
         phi->setInitialRhoMatter(rhoEq);
         chi.setInitialRhoMatter(rhoChiEq);
+        for (std::size_t c = 0; c < res.rhoChiChannels_t_eq.size(); c++)
+        {
+            chi.setInitialRhoMatter(res.rhoChiChannels_t_eq[c], c);
+        }
         
-        auto [tau_eq, rhoPhiMatEq, rhoChiMatEq] = runMatterPhase(t_eq);
+        EqualTime matterEquality = runMatterPhase(t_eq);
+        res.status = statusOf(matterEquality.status, SimulationStatus::NoMatterEquality);
+        if (res.status != SimulationStatus::Ok)
+        {
+            return res;
+        }
+        double tau_eq = matterEquality.t;
+        double rhoPhiMatEq = matterEquality.rho1;
+        double rhoChiMatEq = matterEquality.rho2;
+        res.tau_eqQuadratureError = res.t_eqQuadratureError + matterEquality.densityError;
+        res.multipleCrossings |= matterEquality.crossings > 1;
+        res.tau_eq = tau_eq;
+        res.rhoPhiMatEq = rhoPhiMatEq;
+        res.rhoChiMatEq = rhoChiMatEq;
+        if (!radiationNeeded)
+        {
+            return res;
+        }
+
         phi->setInitialRhoRadiation(rhoPhiMatEq);
         chi.setInitialRhoRadiation(rhoChiMatEq);
-        
-        //auto [t_eq_rad, rhoPhiRadEq, rhoChiRadEq] = runRadiationPhase(tau_eq);
-        auto [tempRH, timeRH] = getReheatingTemperatureAndTime(tau_eq);
-    
-        return SimulationResults{
-            .params = p,
-            .reheating_temp = tempRH,
-            .reheating_time = timeRH,
-            .t_eq = t_eq,
-            .rhoStiff_t_eq = rhoStiffEq,
-            .rhoPhiStiff_t_eq = rhoEq,
-            .rhoChi_t_eq = rhoChiEq,
-            .tau_eq = tau_eq,
-            .rhoPhiMatEq = rhoPhiMatEq,
-            .rhoChiMatEq = rhoChiMatEq,
-            .toMatter = true,
-            .bothFound = bothFound 
-            };
+        for (std::size_t c = 0; c < res.rhoChiChannels_t_eq.size(); c++)
+        {
+            res.rhoChiChannelsMatEq.push_back(chi.energyDensityMatter(t_eq, c)(tau_eq));
+            chi.setInitialRhoRadiation(res.rhoChiChannelsMatEq[c], c);
+        }
+        radiationStart = tau_eq;
     }
     else
     {
         // Now rhoEq is the value of massless particles (rho_chi) at t_eq.
+        res.rhoPhiStiff_t_eq = 0;
+        res.rhoChi_t_eq = rhoEq;
+        res.tau_eq = 0;
+        res.rhoPhiMatEq = 0;
+        res.rhoChiMatEq = 0;
+
+        if (!radiationNeeded)
+        {
+            return res;
+        }
+
         // Calculate value of massive particles at t_eq.
         EnergyDensity rhoPhiStiff = phi->energyDensityStiff();
         double rhoPhiEq = rhoPhiStiff(t_eq);
@@ -63,23 +184,49 @@ SimulationResults Simulation::run()
         // Set initial conditions
         phi->setInitialRhoRadiation(rhoPhiEq);
         chi.setInitialRhoRadiation(rhoEq);
-        auto [tempRH, timeRH] = getReheatingTemperatureAndTime(t_eq);
-
-        return SimulationResults{
-        .params = p,
-        .reheating_temp = tempRH,
-        .reheating_time = timeRH,
-        .t_eq = t_eq,
-        .rhoStiff_t_eq = rhoStiffEq,
-        .rhoChi_t_eq = rhoEq,
-        .tau_eq = 0,
-        .rhoPhiMatEq = 0,
-        .rhoChiMatEq = 0,
-        .toMatter = false,
-        .bothFound = bothFound
-        };
+        for (std::size_t c = 0; c < res.rhoChiChannels_t_eq.size(); c++)
+        {
+            chi.setInitialRhoRadiation(res.rhoChiChannels_t_eq[c], c);
+        }
+        radiationStart = t_eq;
     }
 
+    if (outputs & Outputs::Reheating)
+    {
+        IntegrationUtils::ErrorTally reheatingErrors;
+        auto [tempRH, timeRH] = getReheatingTemperatureAndTime(radiationStart);
+        if (!std::isfinite(tempRH) || !std::isfinite(timeRH))
+        {
+            res.status = SimulationStatus::NonFinite;
+            return res;
+        }
+        double initialError = toMatter ? res.tau_eqQuadratureError : res.t_eqQuadratureError;
+        res.reheatingQuadratureError = initialError + reheatingErrors.largest();
+        res.reheating_temp = tempRH;
+        res.reheating_time = timeRH;
+    }
+
+    if (outputs & Outputs::RadiationEquality)
+    {
+        // Optional output: a radiation phase without a crossing leaves the fields NaN
+        // instead of failing the whole point.
+        EqualTime radiationEquality = runRadiationPhase(radiationStart);
+        if (radiationEquality.found())
+        {
+            res.t_eq_rad = radiationEquality.t;
+            res.rhoPhiRadEq = radiationEquality.rho1;
+            res.rhoChiRadEq = radiationEquality.rho2;
+            res.multipleCrossings |= radiationEquality.crossings > 1;
+        }
+    }
+
+    if ((outputs & Outputs::Sensitivities) && p.channels.empty())
+    {
+        SensitivityAnalysis(p, densityBudget, IntegrationUtils::ErrorBudget{.relative = reheatingTolerance})
+            .apply(res);
+    }
+
+    return res;
 }
 
 
@@ -94,81 +241,87 @@ bool Simulation::toMatter(const EnergyDensity &rhoChi, double rhoPhi, double tim
 }
 
 
-std::tuple<bool, double, double, double, bool> Simulation::runStiffPhase()
+Simulation::StiffEquality Simulation::runStiffPhase()
 {
+    ProfileScope scope(ProfilePhase::Stiff);
     EnergyDensity rhoChiStiff = chi.energyDensityStiff();
     EnergyDensity rhoPhiStiff = phi->energyDensityStiff();
     EnergyDensity rhoStiff = stiff.energyDensity();
+    EnergyDensityDerivative dRhoChiStiff = chi.energyDensityStiffDerivative();
+    EnergyDensityDerivative dRhoPhiStiff = phi->energyDensityStiffDerivative();
+    EnergyDensityDerivative dRhoStiff = stiff.energyDensityDerivative();
 
     // Compute the equality times if they exist
-    auto stiffPhi = EqualTimeSolver(rhoStiff, rhoPhiStiff, p.t0).findEqualTime();  // Equal time for stiff and phi
-    auto stiffChi = EqualTimeSolver(rhoStiff, rhoChiStiff, p.t0).findEqualTime();  // Equal time for stiff and chi
+    EqualTime stiffPhi = EqualTimeSolver(rhoStiff, dRhoStiff, rhoPhiStiff, dRhoPhiStiff, p.t0).solve();  // Equal time for stiff and phi
+    EqualTime stiffChi = EqualTimeSolver(rhoStiff, dRhoStiff, rhoChiStiff, dRhoChiStiff, p.t0).solve();  // Equal time for stiff and chi
+    const SimulationStatus ok = SimulationStatus::Ok;
 
     // Pick the one which is earlier
-    if (stiffPhi && stiffChi)
+    if (stiffPhi.found() && stiffChi.found())
     {
-        auto [t_phi, rhoStiffPhi, RhoPhiEq] = *stiffPhi;
-        auto [t_chi, rhoStiffChi, RhoChiEq] = *stiffChi;
-
-        if (t_phi < t_chi)
+        if (stiffPhi.t < stiffChi.t)
         {
-            //std::cout << "Both found -> to matter" << std::endl;
             // First bool: toMatter, last bool: both found.
-            return {true, t_phi, rhoStiffPhi, RhoPhiEq, true};  // -> matter
+            return {ok, true, stiffPhi.t, stiffPhi.rho1, stiffPhi.rho2, true, stiffPhi.densityError, stiffPhi.crossings > 1};  // -> matter
         }
         else
         {
-            //std::cout << "Both found -> to radiation" << std::endl;
-            return {false, t_chi, rhoStiffChi, RhoChiEq, true}; // -> radiation
+            return {ok, false, stiffChi.t, stiffChi.rho1, stiffChi.rho2, true, stiffChi.densityError, stiffChi.crossings > 1}; // -> radiation
         }
     }
 
-    if (stiffPhi)
+    if (stiffPhi.found())
     {
-        auto [t_phi, rhoStiffEq, RhoPhiEq] = *stiffPhi;
-        //std::cout << "Only phi found --> matter" << std::endl;
-        return {true, t_phi, rhoStiffEq, RhoPhiEq, false};  // -> matter
+        return {ok, true, stiffPhi.t, stiffPhi.rho1, stiffPhi.rho2, false, stiffPhi.densityError, stiffPhi.crossings > 1};  // -> matter
     }
 
-    if (stiffChi)
+    if (stiffChi.found())
     {
-        auto [t_chi, rhoStiffEq, RhoChiEq] = *stiffChi;
-        //std::cout << "Only chi found --> radiation" << std::endl;
-        return {false, t_chi, rhoStiffEq, RhoChiEq, false}; // -> radiation
+        return {ok, false, stiffChi.t, stiffChi.rho1, stiffChi.rho2, false, stiffChi.densityError, stiffChi.crossings > 1}; // -> radiation
     }
 
-    // Something is wrong if this is hit.
-    throw std::runtime_error("No transition from stiff phase.");
+    // No transition from the stiff phase. A numerical failure of either search explains
+    // this better than a missing crossing.
+    SimulationStatus status = SimulationStatus::NoStiffEquality;
+    for (RootStatus rootStatus : {stiffPhi.status, stiffChi.status})
+    {
+        if (rootStatus != RootStatus::NoBracket && status == SimulationStatus::NoStiffEquality)
+        {
+            status = statusOf(rootStatus, status);
+        }
+    }
+    const double nan = SimulationResults::notComputed;
+    return {status, false, nan, nan, nan, false, nan, false};
 }
 
 
 
-std::tuple<double, double, double> Simulation::runMatterPhase(double t0)
+EqualTime Simulation::runMatterPhase(double t0)
 {
+    ProfileScope scope(ProfilePhase::Matter);
     EnergyDensity rhoPhiMat = phi->energyDensityMatter(t0);
     EnergyDensity rhoChiMat = chi.energyDensityMatter(t0);
-    auto radMatSolver = EqualTimeSolver(rhoPhiMat, rhoChiMat, t0);
+    auto radMatSolver = EqualTimeSolver(rhoPhiMat, phi->energyDensityMatterDerivative(t0),
+                                        rhoChiMat, chi.energyDensityMatterDerivative(t0), t0);
 
-    auto [tau_eq, rhoPhiMatEq, rhoChiMatEq] = radMatSolver.getEqualTime();
-
-    return {tau_eq, rhoPhiMatEq, rhoChiMatEq};
+    return radMatSolver.solve();
 }
 
-std::tuple<double, double, double> Simulation::runRadiationPhase(double t0)
+EqualTime Simulation::runRadiationPhase(double t0)
 {
+    ProfileScope scope(ProfilePhase::Radiation);
     EnergyDensity rhoPhiRad = phi->energyDensityRadiation(t0);
     EnergyDensity rhoChiRad = chi.energyDensityRadiation(t0);
-    auto radSolver = EqualTimeSolver(rhoPhiRad, rhoChiRad, t0);
-    auto [t_eq_rad, rhoPhiRadEq, rhoChiRadEq] = radSolver.getEqualTime();
-
-    return {t_eq_rad, rhoPhiRadEq, rhoChiRadEq};
+    auto radSolver = EqualTimeSolver(rhoPhiRad, phi->energyDensityRadiationDerivative(t0),
+                                     rhoChiRad, chi.energyDensityRadiationDerivative(t0), t0);
+    return radSolver.solve();
 }
 
 std::pair<double, double> Simulation::getReheatingTemperatureAndTime(double tau_eq)
 {
-    EnergyDensity rhoChiRad = this->chi.energyDensityRadiation(tau_eq);
-    auto t_rh = maximize(rhoChiRad, tau_eq, tau_eq * 1e5);
-    double reheatingTemperature = IntegrationUtils::integrate(this->chi.energyDensityRadiation(tau_eq),tau_eq, t_rh);
+    ProfileScope scope(ProfilePhase::Reheating);
+    // Maximum of rho_chi and its time integral from a single incremental sweep.
+    auto [t_rh, reheatingTemperature] = this->chi.radiationPeak(tau_eq, tau_eq * 1e5, reheatingTolerance);
     double T_RH = pow(reheatingTemperature, 1.0 / 4.0);
     return std::pair(T_RH, t_rh);
 }
@@ -1,13 +1,24 @@
+#include <cmath>
+#include <optional>
+
+#include "simulation/analytic_estimate.hpp"
 #include "simulation/simulation_manager.hpp"
+#include "utils/memory.hpp"
+#include "writers/collecting_writer.hpp"
 
 SimulationManager::SimulationManager(std::vector<ModelParameters> params,
                                       std::unique_ptr<ResultsWriter> writer_,
-                                      std::size_t workerCount)
-    : tasks(std::make_move_iterator(params.begin()),
-            std::make_move_iterator(params.end())),
-      writer{std::move(writer_)},
-      totalSimulationCount{static_cast<int>(params.size())}
+                                      std::size_t workerCount,
+                                      unsigned outputs_)
+    : writer{std::move(writer_)},
+      totalSimulationCount{static_cast<int>(params.size())},
+      outputs{outputs_}
     {
+        for (auto& p : params)
+        {
+            tasks.push_back(Task{std::move(p)});
+        }
+
         if (workerCount == 0)
         {
             workerCount = 1;
@@ -16,25 +27,124 @@ SimulationManager::SimulationManager(std::vector<ModelParameters> params,
     }; 
 
 
+void SimulationManager::setBudget(TaskBudget budget_, int retries, double retryScale)
+{
+    budget = budget_;
+    budgetRetries = retries;
+    budgetRetryScale = retryScale;
+}
+
+
+void SimulationManager::setPrecision(const PrecisionTargets& targets)
+{
+    precision = targets;
+}
+
+
+void SimulationManager::setResultStore(ResultStore* store_)
+{
+    store = store_;
+}
+
+
+void SimulationManager::setProfiling(bool enabled)
+{
+    profiling = enabled;
+}
+
+
+void SimulationManager::setTriage(double maxError)
+{
+    triageTolerance = maxError;
+}
+
+
+void SimulationManager::setProgressOutput(bool enabled)
+{
+    reportProgress = enabled;
+}
+
+
 void SimulationManager::run()
+{
+    start();
+    close();
+}
+
+
+void SimulationManager::start()
 {
     // Launch threads
     for (std::size_t i = 0; i < workers.capacity(); i++)
     {
         workers.emplace_back(&SimulationManager::workerLoop, this);
     }
+}
+
+
+void SimulationManager::submit(ModelParameters params)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMtx);
+        tasks.push_back(Task{std::move(params)});
+        totalSimulationCount++;
+    }
+    cv.notify_one();
+}
+
+
+void SimulationManager::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMtx);
+        closed = true;
+        if (tasks.empty() && tasksInFlight == 0)
+        {
+            stop = true;
+        }
+    }
+    cv.notify_all();
 
     for (auto &th : workers)
     {
         th.join();  // Wait until finished
     }
+    workers.clear();
+}
+
+
+std::vector<SimulationResults> SimulationManager::runBatch(std::vector<ModelParameters> params,
+                                                          ResultsWriter* forward,
+                                                          std::size_t workerCount,
+                                                          unsigned outputs,
+                                                          const PrecisionTargets& precision)
+{
+    if (params.empty())
+    {
+        return {};
+    }
+
+    auto collector = std::make_unique<CollectingWriter>(forward);
+    CollectingWriter* results = collector.get();
+
+    SimulationManager manager(std::move(params), std::move(collector), workerCount, outputs);
+    manager.setPrecision(precision);
+    manager.run();
+
+    auto collected = results->take();
+    std::erase_if(collected, [](const SimulationResults& res) {return res.status != SimulationStatus::Ok;});
+    return collected;
 }
 
 void SimulationManager::workerLoop()
 {
+    // Memory and simulation context of this worker, reused by all of its tasks.
+    SimulationArena arena;
+    std::optional<Simulation> sim;
+
     while (true)
     {
-        ModelParameters p;
+        Task task;
 
         {
             std::unique_lock<std::mutex> lock(queueMtx);
@@ -47,45 +157,141 @@ void SimulationManager::workerLoop()
                 else {continue;}
             }
 
-            p = std::move(tasks.front());
+            task = std::move(tasks.front());
             tasks.pop_front();
+            tasksInFlight++;
+        }
 
-            // If last task
-            if (tasks.empty())
-            {
-                stop = true;  // Only last thread sets stop.
-                cv.notify_all();
-            }
+        const ModelParameters& p = task.params;
+        bool requeue = false;
 
-        }
+        auto writeFailure = [&](SimulationStatus status)
+        {
+            ++simulationCounter;
+            SimulationResults res;
+            res.params = p;
+            res.status = status;
+            writer->write(res);
+        };
 
         try
         {
-            Simulation sim(std::move(p));
-            SimulationResults res = sim.run(); // Results of one individual run.
+            std::optional<SimulationResults> stored;
+            if (store && !profiling && (stored = store->lookup(p, outputs, precision)))
+            {
+                writer->write(*stored);
+                ++simulationCounter;
+                finishTask(task, false);
+                continue;
+            }
+
+            if (triageTolerance && !profiling && !(outputs & ~unsigned(Outputs::Default)))
+            {
+                std::optional<SimulationResults> estimate = AnalyticEstimate(p).run();
+                if (estimate && estimate->approximationError <= *triageTolerance)
+                {
+                    writer->write(*estimate);
+                    ++simulationCounter;
+                    finishTask(task, false);
+                    continue;
+                }
+            }
+
+            // Budget of this attempt, grown on every retry.
+            TaskBudget attemptBudget = budget;
+            double scale = pow(budgetRetryScale, task.attempt);
+            attemptBudget.seconds *= scale;
+            attemptBudget.evaluations = static_cast<std::uint64_t>(attemptBudget.evaluations * scale);
+
+            SimulationResults res;
+            RunProfile profile;
+            arena.resetCounters();
+            {
+                std::optional<BudgetGuard> guard;
+                if (!budget.unlimited())
+                {
+                    guard.emplace(attemptBudget);
+                }
+                std::optional<Profiler> profiler;
+                if (profiling)
+                {
+                    profiler.emplace(profile);
+                }
+
+                if (sim)
+                {
+                    sim->rebind(p);
+                }
+                else
+                {
+                    sim.emplace(p, arena.resource());
+                    sim->setPrecision(precision);
+                }
+                res = sim->run(outputs); // Results of one individual run.
+            }
+            res.allocations = arena.getAllocations();
+            res.allocatedBytes = arena.getBytes();
+            if (profiling)
+            {
+                res.profile = profile;
+            }
             writer->write(res); // Append the result file.
+            if (store)
+            {
+                store->store(res, outputs, precision);
+            }
 
             int currentSim = ++simulationCounter;
+            if (reportProgress)
             {
                 static std::mutex outputMtx;
                 std::lock_guard<std::mutex> lock(outputMtx);
                 std::cout << "Simulation: " << currentSim << "/" << totalSimulationCount << std::endl;
             }
         }
-        catch (const boost::wrapexcept<std::domain_error>& ex)
+        catch (const BudgetExceeded& ex)
         {
-            ++simulationCounter;
-            std::cerr << "Domain error in simulation: " << ex.what() << "\n" << "(m, lambda, b) = " << p.m << ", " << p.lambda << ", " << p.b;
+            if (task.attempt < budgetRetries)
+            {
+                requeue = true;
+            }
+            else
+            {
+                writeFailure(SimulationStatus::OverBudget);
+            }
         }
         catch (const std::exception& ex)
         {
-            ++simulationCounter;
             std::cerr << "Standard exception: " << ex.what() << "\n";
+            writeFailure(SimulationStatus::Failed);
         }
         catch (...)
         {
-            ++simulationCounter;
             std::cerr << "Unknown error occurred during simulation.\n";
+            writeFailure(SimulationStatus::Failed);
+        }
+
+        finishTask(task, requeue);
+    }
+}
+
+
+void SimulationManager::finishTask(Task& task, bool requeue)
+{
+    {
+        std::lock_guard<std::mutex> lock(queueMtx);
+        if (requeue)
+        {
+            task.attempt++;
+            tasks.push_back(std::move(task));
+        }
+        tasksInFlight--;
+
+        // Last task finished: nothing can be re-queued or submitted any more.
+        if (closed && tasks.empty() && tasksInFlight == 0)
+        {
+            stop = true;
         }
     }
-}
\ No newline at end of file
+    cv.notify_all();
+}
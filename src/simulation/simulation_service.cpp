@@ -0,0 +1,188 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "simulation/simulation_service.hpp"
+#include "writers/csv_writer.hpp"
+
+
+// Hands every finished result back to the service.
+class SimulationService::StreamWriter : public ResultsWriter
+{
+    private:
+        SimulationService& service;
+    public:
+        explicit StreamWriter(SimulationService& service_) : service{service_} {};
+        void write(const SimulationResults& res) override {service.deliver(res);};
+};
+
+
+SimulationService::SimulationService(std::istream& in_, std::ostream& out_,
+                                     std::size_t workerCount, unsigned outputs,
+                                     const PrecisionTargets& precision)
+    : in{in_},
+      out{out_},
+      manager({}, std::make_unique<StreamWriter>(*this), workerCount, outputs)
+    {
+        manager.setProgressOutput(false);  // The output stream carries results only.
+        manager.setPrecision(precision);
+    };
+
+
+std::vector<ModelParameters> SimulationService::parseRequest(const std::string& line, std::string& id)
+{
+    auto parseValues = [](const std::string& key, const std::string& list)
+    {
+        std::vector<double> values;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ','))
+        {
+            std::size_t used = 0;
+            double value = std::stod(item, &used);
+            if (used != item.size())
+            {
+                throw std::invalid_argument("Bad value for " + key + ": " + item);
+            }
+            values.push_back(value);
+        }
+        if (values.empty())
+        {
+            throw std::invalid_argument("No values for " + key);
+        }
+        return values;
+    };
+
+    std::map<std::string, std::vector<double>> values{{"t0", {ModelParameters{}.t0}},
+                                                      {"G_N", {ModelParameters{}.G_N}}};
+    std::stringstream tokens(line);
+    std::string token;
+    while (tokens >> token)
+    {
+        auto eq = token.find('=');
+        if (eq == std::string::npos)
+        {
+            throw std::invalid_argument("Expected key=value, got " + token);
+        }
+
+        std::string key = token.substr(0, eq);
+        std::string value = token.substr(eq + 1);
+        if (key == "id")
+        {
+            id = value;
+        }
+        else if (key == "m" || key == "lambda" || key == "b" || key == "xi" || key == "t0" || key == "G_N")
+        {
+            values[key] = parseValues(key, value);
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown key " + key);
+        }
+    }
+
+    for (const char* key : {"m", "lambda", "b", "xi"})
+    {
+        if (!values.count(key))
+        {
+            throw std::invalid_argument(std::string("Missing ") + key);
+        }
+    }
+
+    std::vector<ModelParameters> params;
+    ModelParameters p;
+    for (double t0 : values["t0"])
+    for (double G_N : values["G_N"])
+    for (double lambda : values["lambda"])
+    for (double xi : values["xi"])
+    for (double b : values["b"])
+    for (double m : values["m"])
+    {
+        p.t0 = t0;
+        p.G_N = G_N;
+        p.lambda = lambda;
+        p.xi = xi;
+        p.b = b;
+        p.m = m;
+        params.push_back(p);
+    }
+    return params;
+}
+
+
+void SimulationService::deliver(const SimulationResults& res)
+{
+    std::lock_guard<std::mutex> lock(outMtx);
+    auto waiting = pending.find(res.params);
+    if (waiting == pending.end())
+    {
+        return;
+    }
+
+    std::string id = waiting->second.front();
+    waiting->second.pop_front();
+    if (waiting->second.empty())
+    {
+        pending.erase(waiting);
+    }
+
+    out << id << ',' << CSVWriter::toCSVRow(res) << "\n";
+    if (--remaining[id] == 0)
+    {
+        remaining.erase(id);
+        out << "# done " << id << "\n";
+    }
+    out.flush();
+}
+
+
+void SimulationService::run()
+{
+    {
+        std::lock_guard<std::mutex> lock(outMtx);
+        out << "# id," << CSVWriter::header() << std::endl;
+    }
+    manager.start();
+
+    std::string line;
+    while (std::getline(in, line))
+    {
+        auto first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#')
+        {
+            continue;
+        }
+        if (line.compare(first, 4, "quit") == 0)
+        {
+            break;
+        }
+
+        std::string id = std::to_string(++requestCounter);
+        std::vector<ModelParameters> params;
+        try
+        {
+            params = parseRequest(line, id);
+        }
+        catch (const std::exception& ex)
+        {
+            std::lock_guard<std::mutex> lock(outMtx);
+            out << "# error " << ex.what() << std::endl;
+            continue;
+        }
+
+        {
+            // Register before submitting so that no result can arrive unannounced.
+            std::lock_guard<std::mutex> lock(outMtx);
+            for (const auto& p : params)
+            {
+                pending[p].push_back(id);
+                remaining[id]++;
+            }
+        }
+        for (auto& p : params)
+        {
+            manager.submit(std::move(p));
+        }
+    }
+
+    manager.close();
+}
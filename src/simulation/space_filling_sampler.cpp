@@ -0,0 +1,183 @@
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+#include "simulation/space_filling_sampler.hpp"
+
+
+namespace
+{
+
+// Portable pseudo-random numbers, so that a design is the same with every standard library.
+std::uint64_t splitMix64(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1) from the top 53 bits.
+double unitDouble(std::uint64_t x)
+{
+    return (x >> 11) * 0x1.0p-53;
+}
+
+
+// Radical inverse of index in the given base.
+double radicalInverse(std::uint64_t index, unsigned base)
+{
+    double inverse = 0.0;
+    double scale = 1.0 / base;
+    while (index > 0)
+    {
+        inverse += (index % base) * scale;
+        index /= base;
+        scale /= base;
+    }
+    return inverse;
+}
+
+
+class SobolDimension
+{
+    private:
+        std::array<std::uint32_t, 32> directions;
+
+    public:
+        /**
+         * Direction numbers from the primitive polynomial of degree s with coefficients a and
+         * the initial numbers m (Joe and Kuo). s = 0 gives the van der Corput sequence.
+         */
+        SobolDimension(unsigned s, std::uint32_t a, std::array<std::uint32_t, 2> m)
+        {
+            for (unsigned k = 0; k < 32; k++)
+            {
+                if (k < s)
+                {
+                    directions[k] = m[k] << (31 - k);
+                    continue;
+                }
+                if (s == 0)
+                {
+                    directions[k] = 1u << (31 - k);
+                    continue;
+                }
+                directions[k] = directions[k - s] ^ (directions[k - s] >> s);
+                for (unsigned j = 1; j < s; j++)
+                {
+                    if ((a >> (s - 1 - j)) & 1u)
+                    {
+                        directions[k] ^= directions[k - j];
+                    }
+                }
+            }
+        }
+
+        double operator()(std::uint64_t index) const
+        {
+            std::uint32_t x = 0;
+            for (unsigned k = 0; k < 32 && index > 0; k++, index >>= 1)
+            {
+                if (index & 1u)
+                {
+                    x ^= directions[k];
+                }
+            }
+            return x * 0x1.0p-32;
+        }
+};
+
+const std::array<SobolDimension, 3> sobol = {
+    SobolDimension(0, 0, {0, 0}),
+    SobolDimension(1, 0, {1, 0}),
+    SobolDimension(2, 1, {1, 3}),
+};
+
+constexpr std::array<unsigned, 3> haltonBases = {2, 3, 5};
+
+double logUniform(double u, double min, double max)
+{
+    return std::pow(10.0, std::log10(min) + u * (std::log10(max) - std::log10(min)));
+}
+
+}
+
+
+SpaceFillingSampler::SpaceFillingSampler(const ModelParameters& base_, SamplerSettings settings_)
+    : base{base_},
+      settings{settings_}
+{
+    if (settings.method != SamplingMethod::LatinHypercube)
+    {
+        return;
+    }
+
+    // Independent random permutation of the strata along every axis (Fisher-Yates).
+    for (std::size_t d = 0; d < dimensions; d++)
+    {
+        auto& perm = strata[d];
+        perm.resize(settings.budget);
+        std::iota(perm.begin(), perm.end(), std::uint64_t{0});
+        std::uint64_t state = splitMix64(settings.seed ^ (d + 1));
+        for (std::uint64_t i = settings.budget; i > 1; i--)
+        {
+            state = splitMix64(state);
+            std::swap(perm[i - 1], perm[state % i]);
+        }
+    }
+}
+
+
+std::array<double, SpaceFillingSampler::dimensions> SpaceFillingSampler::unitPoint(std::uint64_t index) const
+{
+    std::array<double, dimensions> u;
+    for (std::size_t d = 0; d < dimensions; d++)
+    {
+        switch (settings.method)
+        {
+            // Both sequences start at the origin, a corner of the box; skip it.
+            case SamplingMethod::Sobol:
+                u[d] = sobol[d](index + 1);
+                break;
+            case SamplingMethod::Halton:
+                u[d] = radicalInverse(index + 1, haltonBases[d]);
+                break;
+            case SamplingMethod::LatinHypercube:
+            {
+                double jitter = unitDouble(splitMix64(settings.seed ^ splitMix64(index * dimensions + d)));
+                u[d] = (strata[d][index] + jitter) / settings.budget;
+                break;
+            }
+        }
+    }
+    return u;
+}
+
+
+ModelParameters SpaceFillingSampler::point(std::uint64_t index) const
+{
+    if (settings.method == SamplingMethod::LatinHypercube && index >= settings.budget)
+    {
+        throw std::out_of_range("SpaceFillingSampler: index beyond the Latin hypercube budget");
+    }
+
+    auto u = unitPoint(index);
+    ModelParameters p = base;
+    p.m = logUniform(u[0], settings.mMin, settings.mMax);
+    p.lambda = logUniform(u[1], settings.lambdaMin, settings.lambdaMax);
+    p.b = logUniform(u[2], settings.bMin, settings.bMax);
+    return p;
+}
+
+
+std::vector<ModelParameters> SpaceFillingSampler::points(std::uint64_t first) const
+{
+    std::vector<ModelParameters> result;
+    for (std::uint64_t i = first; i < settings.budget; i++)
+    {
+        result.push_back(point(i));
+    }
+    return result;
+}
@@ -0,0 +1,190 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+
+#include "model/energy/creation_decay.hpp"
+#include "model/particles/phase_densities.hpp"
+#include "model/particles/stiff_matter.hpp"
+#include "simulation/trajectory.hpp"
+#include "utils/integration.hpp"
+
+
+namespace
+{
+
+// Chebyshev order of a panel; consecutive panels share their end points.
+constexpr std::size_t order = 32;
+using PanelValues = std::array<double, order + 1>;
+
+// Densities at t together with the running sums of the sweep.
+struct SweepState
+{
+    double t;
+    double rhoPhi;
+    double rhoChi;
+    double S = 0.0;     // Stiff phase: t rho_phi, i.e. e^(-D(t)) times the creation integral
+    double X = 0.0;     // Integral of the chi source rate * rho_phi * a^4 from the phase start
+    double D = 0.0;     // Stiff phase: decay rate at t
+};
+
+bool tooCoarse(const SweepState& a, const SweepState& b, double maxLogStep)
+{
+    for (auto [x, y] : {std::pair{a.rhoPhi, b.rhoPhi}, std::pair{a.rhoChi, b.rhoChi}})
+    {
+        // The stiff phase starts from zero densities.
+        if (x > 0 && y > 0 && std::abs(std::log10(y / x)) > maxLogStep)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Sweeps [start.t, end] on the log grid of the settings. step(state, t) advances a state to
+ * t; emit receives every state after start.
+ */
+template<typename Step, typename Emit>
+SweepState sweep(const SweepState& start, double end, const TrajectorySettings& settings,
+                 Step&& step, Emit&& emit)
+{
+    // Advances over one panel, bisecting it geometrically while it is too coarse.
+    auto advance = [&](auto& self, const SweepState& from, double t, int depth) -> SweepState
+    {
+        SweepState to = step(from, t);
+        if (depth < settings.maxDepth && tooCoarse(from, to, settings.maxLogStep))
+        {
+            SweepState half = self(self, from, std::sqrt(from.t * t), depth + 1);
+            return self(self, half, t, depth + 1);
+        }
+        emit(to);
+        return to;
+    };
+
+    int panels = std::max(1, static_cast<int>(std::ceil(settings.panelsPerDecade * std::log10(end / start.t))));
+    double ratio = std::pow(end / start.t, 1.0 / panels);
+    SweepState state = start;
+    for (int i = 1; i <= panels; i++)
+    {
+        double t = (i == panels) ? end : start.t * std::pow(ratio, i);
+        state = advance(advance, state, t, 0);
+    }
+    return state;
+}
+
+
+/**
+ * Matter or radiation phase from tStart with the given initial densities; rho_phi is closed
+ * form there and rho_chi needs one running integral.
+ */
+template<Epoch E>
+void traceDecayPhase(ModelParameters p, const TrajectorySettings& settings, double tStart,
+                     double tEnd, double phi0, double chi0, double stiff0,
+                     const std::function<void(const TrajectoryPoint&)>& sink)
+{
+    using Traits = EpochTraits<E>;
+    ChiDecayRate decay(p, Traits::n, tStart);
+
+    auto step = [&](const SweepState& from, double t)
+    {
+        PanelValues nodes = IntegrationUtils::chebyshevNodes<order>(from.t, t);
+        PanelValues source;
+        for (std::size_t j = 0; j <= order; j++)
+        {
+            double D = decay(nodes[j]);
+            source[j] = chiSource<E>(D, decayedPhiDensity<E>(tStart, nodes[j], D, phi0), nodes[j]);
+        }
+        SweepState to{t, decayedPhiDensity<E>(tStart, t, decay(t), phi0), 0.0};
+        to.X = from.X + IntegrationUtils::cumulativeChebyshev<order>(source, from.t, t).back();
+        to.rhoChi = chiDensity<E>(to.X, tStart, t, chi0);
+        return to;
+    };
+    auto emit = [&](const SweepState& s)
+    {
+        double rhoStiff = stiff0 * Traits::a3(tStart / s.t) * Traits::a3(tStart / s.t);
+        sink(TrajectoryPoint{E, s.t, rhoStiff, s.rhoPhi, s.rhoChi});
+    };
+
+    SweepState start{tStart, phi0, chi0};
+    emit(start);
+    sweep(start, tEnd, settings, step, emit);
+}
+
+}
+
+
+void TrajectoryTracer::trace(const SimulationResults& res,
+                             const std::function<void(const TrajectoryPoint&)>& sink) const
+{
+    if (std::isnan(res.t_eq) || std::isnan(res.reheating_time))
+    {
+        throw std::invalid_argument("TrajectoryTracer: results lack the default outputs.");
+    }
+
+    using Stiff = EpochTraits<Epoch::Stiff>;
+    ModelParameters params = p;
+    ChiDecayRate decay(params, Stiff::n, p.t0);
+    EnergyDensity rhoStiff = StiffMatter(p).energyDensity();
+
+    // rho_phi = e^(-D(t)) / t * integral of t' C(t') e^(D(t')). The running creation integral
+    // at the panel nodes gives rho_phi there, which the chi source needs.
+    auto step = [&](const SweepState& from, double t)
+    {
+        PanelValues nodes = IntegrationUtils::chebyshevNodes<order>(from.t, t);
+        PanelValues D;
+        PanelValues creation;
+        D[0] = from.D;
+        for (std::size_t j = 1; j <= order; j++)
+        {
+            D[j] = decay(nodes[j]);
+        }
+        // Scaled by e^(-D(t)) against overflow; D grows with time.
+        for (std::size_t j = 0; j <= order; j++)
+        {
+            creation[j] = stiffPhiIntegrand(nodes[j], PhiCreationRate<double>(p.m, p.b, nodes[j]), D[j] - D[order]);
+        }
+        PanelValues created = IntegrationUtils::cumulativeChebyshev<order>(creation, from.t, t);
+
+        PanelValues rhoPhi;
+        PanelValues source;
+        for (std::size_t j = 0; j <= order; j++)
+        {
+            rhoPhi[j] = (std::exp(from.D - D[j]) * from.S + created[j] * std::exp(D[order] - D[j])) / nodes[j];
+            source[j] = chiSource<Epoch::Stiff>(D[j], rhoPhi[j], nodes[j]);
+        }
+
+        SweepState to{t, rhoPhi[order], 0.0};
+        to.D = D[order];
+        to.S = t * to.rhoPhi;
+        to.X = from.X + IntegrationUtils::cumulativeChebyshev<order>(source, from.t, t).back();
+        to.rhoChi = chiDensity<Epoch::Stiff>(to.X, p.t0, t, 0.0);
+        return to;
+    };
+    auto emit = [&](const SweepState& s)
+    {
+        sink(TrajectoryPoint{Epoch::Stiff, s.t, rhoStiff(s.t), s.rhoPhi, s.rhoChi});
+    };
+
+    SweepState start{p.t0, 0.0, 0.0};
+    emit(start);
+    SweepState stiffEnd = sweep(start, res.t_eq, settings, step, emit);
+
+    double stiffAtEquality = rhoStiff(res.t_eq);
+    double tEnd = settings.endFactor * res.reheating_time;
+    if (res.toMatter)
+    {
+        traceDecayPhase<Epoch::Matter>(
+            p, settings, res.t_eq, res.tau_eq, res.rhoPhiStiff_t_eq, res.rhoChi_t_eq,
+            stiffAtEquality, sink);
+        double stiffAtTau = stiffAtEquality * std::pow(EpochTraits<Epoch::Matter>::a3(res.t_eq / res.tau_eq), 2);
+        traceDecayPhase<Epoch::Radiation>(p, settings, res.tau_eq, tEnd, res.rhoPhiMatEq,
+                                          res.rhoChiMatEq, stiffAtTau, sink);
+    }
+    else
+    {
+        // rho_phi at t_eq is not part of the results of a radiation-first run.
+        traceDecayPhase<Epoch::Radiation>(p, settings, res.t_eq, tEnd, stiffEnd.rhoPhi,
+                                          res.rhoChi_t_eq, stiffAtEquality, sink);
+    }
+}
@@ -1,126 +1,349 @@
-#include <future>
+#include <cmath>
+#include <numbers>
 #include <boost/math/tools/roots.hpp>
 #include "solvers/equal_time_solver.hpp"
-#include <iostream>
-#include <iomanip>
+#include "utils/budget.hpp"
+#include "utils/integration.hpp"
 #include <algorithm>
 
 using boost::math::tools::toms748_solve;
 using boost::math::tools::eps_tolerance;
+using boost::math::tools::newton_raphson_iterate;
 
-struct Bracket
+
+namespace
 {
-    double low;
-    double high;
-    double fa;
-    double fb;
+
+/**
+ * Chebyshev interpolant of a function on [-1, 1] from its values at the Chebyshev-Lobatto
+ * points x_j = cos(pi j / n), j = 0..n.
+ */
+class ChebyshevProxy
+{
+    private:
+        std::vector<double> coefficients;
+
+    public:
+        explicit ChebyshevProxy(const std::vector<double>& values)
+        {
+            const std::size_t n = values.size() - 1;
+            coefficients.assign(n + 1, 0.0);
+            for (std::size_t k = 0; k <= n; k++)
+            {
+                double sum = 0.0;
+                for (std::size_t j = 0; j <= n; j++)
+                {
+                    double term = values[j] * std::cos(std::numbers::pi * double(j * k) / double(n));
+                    sum += (j == 0 || j == n) ? term / 2 : term;
+                }
+                coefficients[k] = 2.0 * sum / double(n);
+            }
+            coefficients.front() /= 2;
+            coefficients.back() /= 2;
+        }
+
+        // Largest coefficient of the upper half of the series, the error of the interpolant.
+        double tail() const
+        {
+            double largest = 0.0;
+            for (std::size_t k = coefficients.size() / 2 + 1; k < coefficients.size(); k++)
+            {
+                largest = std::max(largest, std::abs(coefficients[k]));
+            }
+            return largest;
+        }
+
+        // Clenshaw recurrence.
+        double operator()(double x) const
+        {
+            double b1 = 0.0;
+            double b2 = 0.0;
+            for (std::size_t k = coefficients.size() - 1; k > 0; k--)
+            {
+                double b = 2.0 * x * b1 - b2 + coefficients[k];
+                b2 = b1;
+                b1 = b;
+            }
+            return x * b1 - b2 + coefficients[0];
+        }
+
+        // Roots in [-1, 1], in increasing order, from sign changes on a grid finer than the
+        // oscillations of the series.
+        std::vector<double> roots() const
+        {
+            std::vector<double> result;
+            const std::size_t points = 4 * coefficients.size();
+            double xa = -1.0;
+            double fa = (*this)(xa);
+            for (std::size_t i = 1; i <= points; i++)
+            {
+                double xb = -std::cos(std::numbers::pi * double(i) / double(points));
+                double fb = (*this)(xb);
+                if (fa == 0.0)
+                {
+                    result.push_back(xa);
+                }
+                else if (fa * fb < 0)
+                {
+                    std::uintmax_t iterations = 100;
+                    auto root = toms748_solve(*this, xa, xb, fa, fb,
+                        eps_tolerance<double>(std::numeric_limits<double>::digits), iterations);
+                    result.push_back((root.first + root.second) / 2.0);
+                }
+                xa = xb;
+                fa = fb;
+            }
+            if (fa == 0.0)
+            {
+                result.push_back(xa);
+            }
+            return result;
+        }
 };
 
+}
+
+
+/**
+ * log rho1 - log rho2 at t, or rho1 - rho2 where a density is not positive. A non-finite
+ * density sets nonFinite and returns 0, which the root finders take as an exact root, so
+ * the search ends at once instead of iterating on NaN.
+ */
+double EqualTimeSolver::difference(double t)
+{
+    BudgetGuard::check();
+    double val1 = rho1(t);
+    double val2 = rho2(t);
+    if (!std::isfinite(val1) || !std::isfinite(val2))
+    {
+        nonFinite = true;
+        return 0.0;
+    }
+
+    linearDifference = (val1 <= 0 || val2 <= 0);
+    if (linearDifference)
+    {
+        return val1 - val2;
+    }
+    return log(val1) - log(val2);
+}
+
+
 /**
  * Custom bracketing function. Increases upper limit by times 10^1 until sign change is found (this will
- * happen at some point) and returns the found bracket to be used in Toms method.
+ * happen at some point) and returns the last decade, in which the sign changes.
  */
-Bracket findBracket(EnergyDensity h, double low)
+std::optional<EqualTimeSolver::Bracket> EqualTimeSolver::findBracket()
 {
-    double fa = h(low);
-    double high = low * 10.0;
-    double fb = h(high);
+    double low = lowerLimit;
+    double fa = difference(low);
+    bool linearLow = linearDifference;
+    double high = lowerLimit * 10.0;
+    double fb = difference(high);
 
     const int maxAttempts = 150;
     int attempts = 0;
     // Increase upperlimit until bracket is found. Equations show this will happen at some point.
-    
-    while (fa * fb > 0 && attempts < maxAttempts)
+    while (fa * fb > 0 && attempts < maxAttempts && !nonFinite)
     {
+        BudgetGuard::check();
+        low = high;
+        fa = fb;
+        linearLow = linearDifference;
         high *= 10.0;
-        fb = h(high);
+        fb = difference(high);
         attempts++;
     }
 
-    if (fa * fb > 0)
+    if (nonFinite || fa * fb > 0)
     {
-        throw std::runtime_error("Failed to bracket root.");
+        return std::nullopt;
     }
-
-    
-    return {low, high, fa, fb};
+    return Bracket{low, high, fa, fb, !linearLow && !linearDifference};
 }
 
-std::tuple<double, double, double> EqualTimeSolver::getEqualTime()
+
+/**
+ * Samples the difference at Chebyshev-Lobatto points in log t over the bracket, whose ends are
+ * already known, doubling their number and reusing the previous samples until the upper half
+ * of the series is below proxyTolerance or maxProxyOrder is reached.
+ */
+std::optional<std::vector<double>> EqualTimeSolver::proxyRoots(const Bracket& bracket)
 {
-        // Function difference
+    if (!bracket.logarithmic)
+    {
+        return std::nullopt;
+    }
+    const double sLow = log(bracket.low);
+    const double sHigh = log(bracket.high);
+    auto time = [&](double x) {return exp(sLow + (x + 1.0) / 2.0 * (sHigh - sLow));};
 
-        auto h = [&](double t) -> double {
-            double val1 = rho1(t);
-            double val2 = rho2(t);
+    std::vector<double> values{bracket.fb, bracket.fa};
+    std::size_t n = 1;
+    while (true)
+    {
+        // Samples at the new odd points cos(pi j / 2n) between the previous ones.
+        std::vector<double> refined(2 * n + 1);
+        for (std::size_t j = 0; j <= 2 * n; j++)
+        {
+            if (j % 2 == 0)
+            {
+                refined[j] = values[j / 2];
+                continue;
+            }
+            refined[j] = difference(time(std::cos(std::numbers::pi * double(j) / double(2 * n))));
+            if (nonFinite || linearDifference)
+            {
+                return std::nullopt;
+            }
+        }
+        values = std::move(refined);
+        n *= 2;
 
-            if (val1 <= 0 || val2 <= 0)
+        ChebyshevProxy proxy(values);
+        double scale = 0.0;
+        for (double value : values)
+        {
+            scale = std::max(scale, std::abs(value));
+        }
+        if (n >= 4 && (proxy.tail() <= proxyTolerance * scale || n >= maxProxyOrder))
+        {
+            std::vector<double> roots = proxy.roots();
+            for (double& root : roots)
             {
-                return val1 - val2;
+                root = time(root);
             }
+            return roots;
+        }
+    }
+}
 
-            double log1 = log(val1);
-            double log2 = log(val2);
-            double result = log1 - log2;
-            //std::cout << "  [TOMS748] Evaluating h(t): t = " << t << ", log_rho1(t) = " << log1 << ", log_rho2(t)= " << log2 <<", h(t)= " << result << "\n";
-            return result;
-        };
 
+std::pair<double, RootStatus> EqualTimeSolver::solveInBracket(const Bracket& bracket, double guess)
+{
+    auto [low, high, fa, fb, logarithmic] = bracket;
+    std::uintmax_t iterations = maxIter;
+    double root;
 
-        std::pair<double, double> result;
+    if (!drho1 || !drho2)
+    {
+        auto h = [&](double t) {return difference(t);};
         const int digits = std::numeric_limits<double>::digits;
-        Bracket bracket = findBracket(h, lowerLimit);
-        result = toms748_solve(h, bracket.low, bracket.high, bracket.fa, bracket.fb, eps_tolerance<double>(digits), maxIter);
+        // The proxy root is accurate to about proxyTolerance in log t; try a bracket of a
+        // few times that around it before the whole one.
+        const double margin = std::exp(100.0 * proxyTolerance);
+        double narrowLow = std::max(low, guess / margin);
+        double narrowHigh = std::min(high, guess * margin);
+        if (narrowLow > low && narrowHigh < high)
+        {
+            double fLow = difference(narrowLow);
+            double fHigh = difference(narrowHigh);
+            if (fLow * fHigh <= 0 && !nonFinite)
+            {
+                low = narrowLow;
+                high = narrowHigh;
+                fa = fLow;
+                fb = fHigh;
+            }
+        }
+        auto result = toms748_solve(h, low, high, fa, fb, eps_tolerance<double>(digits), iterations);
+        root = (result.first + result.second) / 2.0;
+    }
+    else
+    {
+        // log rho1 - log rho2 and its derivative rho1'/rho1 - rho2'/rho2 from one evaluation
+        // of each density.
+        auto h = [&](double t) -> std::pair<double, double>
+        {
+            BudgetGuard::check();
+            double val1 = rho1(t);
+            double val2 = rho2(t);
+            double d1 = drho1(t, val1);
+            double d2 = drho2(t, val2);
+            if (!std::isfinite(val1) || !std::isfinite(val2) || !std::isfinite(d1) || !std::isfinite(d2))
+            {
+                nonFinite = true;
+                return {0.0, 1.0};
+            }
+            if (val1 <= 0 || val2 <= 0)
+            {
+                return {val1 - val2, d1 - d2};
+            }
+            return {log(val1) - log(val2), d1 / val1 - d2 / val2};
+        };
 
-        double timeEquality = (result.first + result.second) / 2.0;
-        double rho1Equal = rho1(timeEquality);
-        double rho2Equal = rho2(timeEquality);
+        // Each density carries quadrature noise of roughly 1e-12, below which Newton steps
+        // only chase the noise.
+        const int digits = 40;
+        root = newton_raphson_iterate(h, guess, low, high, digits, iterations);
+    }
 
-        return std::make_tuple(timeEquality, rho1Equal, rho2Equal);
+    if (nonFinite || !std::isfinite(root))
+    {
+        return {root, RootStatus::NonFinite};
+    }
+    if (iterations >= maxIter)
+    {
+        return {root, RootStatus::NotConverged};
+    }
+    return {root, RootStatus::Found};
 }
 
 
-// New logic
-
-std::optional<std::tuple<double, double, double>> EqualTimeSolver::findEqualTime()
+EqualTime EqualTimeSolver::solve()
 {
-    const int digits = std::numeric_limits<double>::digits;
-    auto h = [&](double t) -> double
+    nonFinite = false;
+    EqualTime result;
+
+    auto bracket = findBracket();
+    if (!bracket)
     {
-        double val1 = rho1(t);
-        double val2 = rho2(t);
+        result.status = nonFinite ? RootStatus::NonFinite : RootStatus::NoBracket;
+        return result;
+    }
 
-        if (val1 <= 0 | val2 <= 0)
+    // Without a proxy the difference of the logarithms is still close to linear in log t;
+    // start from its secant.
+    auto [low, high, fa, fb, logarithmic] = *bracket;
+    double guess = (fa != fb) ? low * pow(high / low, fa / (fa - fb)) : sqrt(low * high);
+    result.crossings = 1;
+    if (auto roots = proxyRoots(*bracket); roots && !roots->empty())
+    {
+        guess = roots->front();
+        result.crossings = roots->size();
+        if (roots->size() > 1)
         {
-            return val1 - val2;
+            // Keep the polish away from the later crossings.
+            double mid = sqrt(roots->at(0) * roots->at(1));
+            bracket->high = mid;
+            bracket->fb = difference(mid);
         }
-
-        double log1 = log(val1);
-        double log2 = log(val2);
-        double result = log1 - log2;
-        //std::cout << "  [TOMS748] Evaluating h(t): t = " << t << ", log_rho1(t) = " << log1 << ", log_rho2(t)= " << log2 <<", h(t)= " << result << "\n";
+    }
+    if (nonFinite)
+    {
+        result.status = RootStatus::NonFinite;
         return result;
-    };
-
-    Bracket bracket = findBracket(h, lowerLimit);
+    }
 
-    if (bracket.fa * bracket.fb > 0)
+    auto [timeEquality, status] = solveInBracket(*bracket, guess);
+    result.status = status;
+    if (status != RootStatus::Found)
     {
-        return std::nullopt; // No root exists
+        return result;
     }
 
-    try
+    // The errors of both densities add up in their ratio.
+    result.t = timeEquality;
+    result.densityError = 0.0;
+    for (auto [rho, value] : {std::pair{&rho1, &result.rho1}, std::pair{&rho2, &result.rho2}})
     {
-        auto result = toms748_solve(h, bracket.low, bracket.high, bracket.fa, bracket.fb, eps_tolerance<double>(digits), maxIter);
-        double timeEquality = (result.first + result.second) / 2.0;
-        double rho1Equal = rho1(timeEquality);
-        double rho2Equal = rho2(timeEquality);
-
-        return std::make_tuple(timeEquality, rho1Equal, rho2Equal);
+        IntegrationUtils::ErrorTally errors;
+        *value = (*rho)(timeEquality);
+        result.densityError += errors.largest();
     }
-    catch (...)
+    if (!std::isfinite(result.rho1) || !std::isfinite(result.rho2))
     {
-        return std::nullopt;
+        result.status = RootStatus::NonFinite;
     }
-
-}
\ No newline at end of file
+    return result;
+}
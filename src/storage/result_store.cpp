@@ -0,0 +1,334 @@
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "storage/result_store.hpp"
+
+
+namespace
+{
+
+constexpr char magic[8] = {'R', 'H', 'S', 'T', 'O', 'R', 'E', '1'};
+
+// Record header: payload length and checksum of the payload.
+struct RecordHeader
+{
+    std::uint64_t size;
+    std::uint64_t checksum;
+};
+
+std::uint64_t fnv1a(std::string_view bytes)
+{
+    std::uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : bytes)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::system_error systemError(const std::string& what)
+{
+    return std::system_error(errno, std::generic_category(), what);
+}
+
+
+class Encoder
+{
+    private:
+        std::string bytes;
+    public:
+        template<typename T>
+        void put(const T& value)
+        {
+            bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void put(const std::vector<double>& values)
+        {
+            put<std::uint64_t>(values.size());
+            for (double v : values) {put(v);}
+        }
+
+        std::size_t size() const {return bytes.size();}
+        std::string take() {return std::move(bytes);}
+};
+
+
+class Decoder
+{
+    private:
+        std::string_view bytes;
+    public:
+        explicit Decoder(std::string_view bytes_) : bytes{bytes_} {};
+
+        template<typename T>
+        T get()
+        {
+            if (bytes.size() < sizeof(T))
+            {
+                throw std::runtime_error("ResultStore: truncated record");
+            }
+            T value;
+            std::memcpy(&value, bytes.data(), sizeof(T));
+            bytes.remove_prefix(sizeof(T));
+            return value;
+        }
+
+        std::vector<double> getVector()
+        {
+            std::vector<double> values(get<std::uint64_t>());
+            for (double& v : values) {v = get<double>();}
+            return values;
+        }
+};
+
+
+// The key part of a payload: version, outputs, precision and the parameters.
+void encodeKey(Encoder& e, std::uint64_t version, unsigned outputs, const PrecisionTargets& precision,
+               const ModelParameters& p)
+{
+    e.put(version);
+    e.put<std::uint32_t>(outputs);
+    e.put(precision.equalityTime);
+    e.put(precision.reheatingTemp);
+    e.put(p.t0);
+    e.put(p.m);
+    e.put(p.lambda);
+    e.put(p.b);
+    e.put(p.xi);
+    e.put(p.G_N);
+    e.put<std::uint64_t>(p.channels.size());
+    for (const auto& channel : p.channels)
+    {
+        e.put(channel.lambda);
+        e.put(channel.xi);
+    }
+}
+
+std::string encodeResults(const SimulationResults& r)
+{
+    Encoder e;
+    for (double v : {r.reheating_temp, r.reheating_time, r.t_eq, r.rhoStiff_t_eq,
+                     r.rhoPhiStiff_t_eq, r.rhoChi_t_eq, r.tau_eq, r.rhoPhiMatEq, r.rhoChiMatEq,
+                     r.t_eq_rad, r.rhoPhiRadEq, r.rhoChiRadEq,
+                     r.t_eqQuadratureError, r.tau_eqQuadratureError, r.reheatingQuadratureError})
+    {
+        e.put(v);
+    }
+    e.put<std::uint8_t>(r.toMatter);
+    e.put<std::uint8_t>(r.bothFound);
+    e.put<std::uint8_t>(r.multipleCrossings);
+    e.put(r.rhoChiChannels_t_eq);
+    e.put(r.rhoChiChannelsMatEq);
+    e.put<std::uint64_t>(r.allocations);
+    e.put<std::uint64_t>(r.allocatedBytes);
+    for (const auto* gradient : {&r.dReheatingTemp, &r.dReheatingTime, &r.dt_eq, &r.dtau_eq})
+    {
+        e.put(*gradient);
+    }
+    return e.take();
+}
+
+void decodeResults(Decoder& d, SimulationResults& r)
+{
+    for (double* v : {&r.reheating_temp, &r.reheating_time, &r.t_eq, &r.rhoStiff_t_eq,
+                      &r.rhoPhiStiff_t_eq, &r.rhoChi_t_eq, &r.tau_eq, &r.rhoPhiMatEq, &r.rhoChiMatEq,
+                      &r.t_eq_rad, &r.rhoPhiRadEq, &r.rhoChiRadEq,
+                      &r.t_eqQuadratureError, &r.tau_eqQuadratureError, &r.reheatingQuadratureError})
+    {
+        *v = d.get<double>();
+    }
+    r.toMatter = d.get<std::uint8_t>();
+    r.bothFound = d.get<std::uint8_t>();
+    r.multipleCrossings = d.get<std::uint8_t>();
+    r.rhoChiChannels_t_eq = d.getVector();
+    r.rhoChiChannelsMatEq = d.getVector();
+    r.allocations = d.get<std::uint64_t>();
+    r.allocatedBytes = d.get<std::uint64_t>();
+    for (auto* gradient : {&r.dReheatingTemp, &r.dReheatingTime, &r.dt_eq, &r.dtau_eq})
+    {
+        *gradient = d.get<Gradient>();
+    }
+}
+
+}
+
+
+ResultStore::ResultStore(const std::string& file, std::uint64_t version_) : version{version_}
+{
+    std::filesystem::path path(file);
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path());
+    }
+
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        throw systemError("ResultStore: cannot open " + file);
+    }
+
+    try
+    {
+        load();
+    }
+    catch (...)
+    {
+        ::close(fd);
+        throw;
+    }
+}
+
+
+ResultStore::~ResultStore()
+{
+    if (mapping)
+    {
+        ::munmap(const_cast<char*>(mapping), mappedSize);
+    }
+    ::close(fd);
+}
+
+
+void ResultStore::load()
+{
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        throw systemError("ResultStore: cannot stat store");
+    }
+
+    std::size_t fileSize = static_cast<std::size_t>(st.st_size);
+    if (fileSize < sizeof(magic))
+    {
+        // New (or torn before the header was complete) store.
+        if (::ftruncate(fd, 0) != 0 || ::write(fd, magic, sizeof(magic)) != sizeof(magic)
+            || ::fdatasync(fd) != 0)
+        {
+            throw systemError("ResultStore: cannot initialise store");
+        }
+        return;
+    }
+
+    void* map = ::mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+    {
+        throw systemError("ResultStore: cannot map store");
+    }
+    mapping = static_cast<const char*>(map);
+    mappedSize = fileSize;
+
+    if (std::memcmp(mapping, magic, sizeof(magic)) != 0)
+    {
+        throw std::runtime_error("ResultStore: not a result store file");
+    }
+
+    // Index intact records; the first damaged one marks the end of what was synced.
+    std::size_t offset = sizeof(magic);
+    while (offset + sizeof(RecordHeader) <= fileSize)
+    {
+        RecordHeader header;
+        std::memcpy(&header, mapping + offset, sizeof(header));
+        std::size_t begin = offset + sizeof(header);
+        if (header.size > fileSize - begin)
+        {
+            break;
+        }
+
+        std::string_view payload(mapping + begin, header.size);
+        if (fnv1a(payload) != header.checksum)
+        {
+            break;
+        }
+
+        // The key hash covers the leading key part; its length follows from the channel count.
+        std::size_t keySize = sizeof(std::uint64_t) + sizeof(std::uint32_t) + 8 * sizeof(double);
+        if (payload.size() >= keySize + sizeof(std::uint64_t))
+        {
+            std::uint64_t channels;
+            std::memcpy(&channels, payload.data() + keySize, sizeof(channels));
+            keySize += sizeof(std::uint64_t) + channels * 2 * sizeof(double);
+            if (keySize <= payload.size())
+            {
+                index.emplace(fnv1a(payload.substr(0, keySize)), payload);
+            }
+        }
+        offset = begin + header.size;
+    }
+
+    if (offset < fileSize && ::ftruncate(fd, static_cast<off_t>(offset)) != 0)
+    {
+        throw systemError("ResultStore: cannot drop torn record");
+    }
+}
+
+
+std::optional<SimulationResults> ResultStore::lookup(const ModelParameters& p, unsigned outputs,
+                                                    const PrecisionTargets& precision)
+{
+    Encoder keyEncoder;
+    encodeKey(keyEncoder, version, outputs, precision, p);
+    std::string key = keyEncoder.take();
+
+    std::lock_guard<std::mutex> lock(mtx);
+    auto [first, last] = index.equal_range(fnv1a(key));
+    for (auto it = first; it != last; ++it)
+    {
+        std::string_view payload = it->second;
+        if (payload.substr(0, key.size()) != key)
+        {
+            continue;
+        }
+
+        SimulationResults res;
+        res.params = p;
+        Decoder decoder(payload.substr(key.size()));
+        decodeResults(decoder, res);
+        return res;
+    }
+    return std::nullopt;
+}
+
+
+void ResultStore::store(const SimulationResults& res, unsigned outputs, const PrecisionTargets& precision)
+{
+    if (res.status != SimulationStatus::Ok)
+    {
+        return;
+    }
+
+    Encoder keyEncoder;
+    encodeKey(keyEncoder, version, outputs, precision, res.params);
+    std::string payload = keyEncoder.take();
+    std::uint64_t keyHash = fnv1a(payload);
+    payload += encodeResults(res);
+
+    RecordHeader header{payload.size(), fnv1a(payload)};
+    std::string record(reinterpret_cast<const char*>(&header), sizeof(header));
+    record += payload;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    // One write per record: with O_APPEND a crash leaves at most one torn record at the end.
+    if (::write(fd, record.data(), record.size()) != static_cast<ssize_t>(record.size())
+        || ::fdatasync(fd) != 0)
+    {
+        throw systemError("ResultStore: cannot append record");
+    }
+
+    appended.push_back(std::move(payload));
+    index.emplace(keyHash, appended.back());
+}
+
+
+std::size_t ResultStore::size()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return index.size();
+}
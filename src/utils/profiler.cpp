@@ -0,0 +1,168 @@
+#include <cstring>
+
+#include "utils/profiler.hpp"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+namespace
+{
+
+constexpr std::size_t counterCount = 4;
+
+/**
+ * The hardware counters of one thread, opened as a group so that a single read returns
+ * all of them. Members the CPU or the kernel refuses are left out and read as zero.
+ */
+class CounterGroup
+{
+    private:
+        int leader = -1;
+        std::array<int, counterCount> fds;
+        std::array<int, counterCount> slot;     // Position in the group read, -1 if not opened
+
+    public:
+        CounterGroup()
+        {
+            fds.fill(-1);
+            slot.fill(-1);
+#ifdef __linux__
+            const std::array<std::uint64_t, counterCount> configs = {
+                PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+            int opened = 0;
+            for (std::size_t i = 0; i < counterCount; i++)
+            {
+                perf_event_attr attr;
+                std::memset(&attr, 0, sizeof(attr));
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.size = sizeof(attr);
+                attr.config = configs[i];
+                attr.read_format = PERF_FORMAT_GROUP;
+                attr.exclude_kernel = 1;
+                attr.exclude_hv = 1;
+                attr.disabled = (leader == -1);
+
+                // Calling thread on any CPU.
+                int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0));
+                if (fd == -1)
+                {
+                    if (i == 0) {return;}
+                    continue;
+                }
+                if (leader == -1) {leader = fd;}
+                fds[i] = fd;
+                slot[i] = opened++;
+            }
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+        }
+
+        ~CounterGroup()
+        {
+#ifdef __linux__
+            for (int fd : fds)
+            {
+                if (fd != -1) {close(fd);}
+            }
+#endif
+        }
+
+        CounterGroup(const CounterGroup&) = delete;
+        CounterGroup& operator=(const CounterGroup&) = delete;
+
+        bool available() const {return leader != -1;}
+
+        std::array<std::uint64_t, counterCount> read() const
+        {
+            std::array<std::uint64_t, counterCount> counts{};
+#ifdef __linux__
+            if (!available())
+            {
+                return counts;
+            }
+            // Layout of PERF_FORMAT_GROUP: the number of counters followed by their values.
+            std::array<std::uint64_t, counterCount + 1> buffer{};
+            if (::read(leader, buffer.data(), sizeof(buffer)) <= 0)
+            {
+                return counts;
+            }
+            for (std::size_t i = 0; i < counterCount; i++)
+            {
+                if (slot[i] != -1)
+                {
+                    counts[i] = buffer[1 + slot[i]];
+                }
+            }
+#endif
+            return counts;
+        }
+};
+
+CounterGroup& threadCounters()
+{
+    thread_local CounterGroup group;
+    return group;
+}
+
+}
+
+
+const char* phaseName(ProfilePhase phase)
+{
+    switch (phase)
+    {
+        case ProfilePhase::Stiff: return "stiff";
+        case ProfilePhase::Matter: return "matter";
+        case ProfilePhase::Radiation: return "radiation";
+        case ProfilePhase::Reheating: return "reheating";
+        case ProfilePhase::Creation: return "creation";
+        case ProfilePhase::Decay: return "decay";
+        case ProfilePhase::Count: break;
+    }
+    return "unknown";
+}
+
+
+Profiler::Profiler(RunProfile& profile) : previous{current}
+{
+    profile.hardwareCounters = countersAvailable();
+    current = &profile;
+}
+
+Profiler::~Profiler()
+{
+    current = previous;
+}
+
+bool Profiler::countersAvailable()
+{
+    return threadCounters().available();
+}
+
+
+void ProfileScope::begin()
+{
+    startCounts = threadCounters().read();
+    start = std::chrono::steady_clock::now();
+}
+
+void ProfileScope::end()
+{
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    auto counts = threadCounters().read();
+
+    PhaseCounters& c = (*profile)[phase];
+    c.calls++;
+    c.nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    c.cycles += counts[0] - startCounts[0];
+    c.instructions += counts[1] - startCounts[1];
+    c.cacheMisses += counts[2] - startCounts[2];
+    c.branchMisses += counts[3] - startCounts[3];
+}
@@ -0,0 +1,377 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "writers/aggregating_writer.hpp"
+
+
+void StreamingQuantile::add(double x)
+{
+    if (count < 5)
+    {
+        heights[count++] = x;
+        if (count == 5)
+        {
+            std::sort(heights.begin(), heights.end());
+            const double p = probability;
+            positions = {0.0, 1.0, 2.0, 3.0, 4.0};
+            desired = {0.0, 2.0 * p, 4.0 * p, 2.0 + 2.0 * p, 4.0};
+            increments = {0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0};
+        }
+        return;
+    }
+    count++;
+
+    // Cell of x, widening the outer markers if it lies beyond them.
+    std::size_t k;
+    if (x < heights[0])
+    {
+        heights[0] = x;
+        k = 0;
+    }
+    else if (x >= heights[4])
+    {
+        heights[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (x >= heights[k + 1])
+        {
+            k++;
+        }
+    }
+    for (std::size_t i = k + 1; i < 5; i++)
+    {
+        positions[i] += 1.0;
+    }
+    for (std::size_t i = 0; i < 5; i++)
+    {
+        desired[i] += increments[i];
+    }
+
+    // Move the middle markers by one position towards their desired ones.
+    for (std::size_t i = 1; i < 4; i++)
+    {
+        double offset = desired[i] - positions[i];
+        if ((offset >= 1.0 && positions[i + 1] - positions[i] > 1.0)
+            || (offset <= -1.0 && positions[i - 1] - positions[i] < -1.0))
+        {
+            double d = (offset > 0) ? 1.0 : -1.0;
+            double below = positions[i] - positions[i - 1];
+            double above = positions[i + 1] - positions[i];
+            double parabolic = heights[i] + d / (positions[i + 1] - positions[i - 1])
+                             * ((below + d) * (heights[i + 1] - heights[i]) / above
+                                + (above - d) * (heights[i] - heights[i - 1]) / below);
+            if (heights[i - 1] < parabolic && parabolic < heights[i + 1])
+            {
+                heights[i] = parabolic;
+            }
+            else
+            {
+                std::size_t j = (d > 0) ? i + 1 : i - 1;
+                heights[i] += d * (heights[j] - heights[i]) / (positions[j] - positions[i]);
+            }
+            positions[i] += d;
+        }
+    }
+}
+
+double StreamingQuantile::value() const
+{
+    if (count == 0)
+    {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+    if (count < 5)
+    {
+        // Nearest rank of the values so far.
+        std::array<double, 5> sorted = heights;
+        std::sort(sorted.begin(), sorted.begin() + count);
+        auto rank = static_cast<std::size_t>(std::lround(probability * double(count - 1)));
+        return sorted[rank];
+    }
+    return heights[2];
+}
+
+
+AggregatingWriter::AggregatingWriter(unsigned groupBy_, std::vector<Aggregation> aggregations_,
+                                     std::unique_ptr<ResultsWriter> forward_,
+                                     std::size_t emitInterval_, std::string file)
+    : groupBy{groupBy_}, aggregations{std::move(aggregations_)}, forward{std::move(forward_)},
+      emitInterval{emitInterval_}, filename{file}
+{
+    for (const auto& aggregation : aggregations)
+    {
+        if (aggregation.kind == Aggregation::Kind::Histogram
+            && (aggregation.bins == 0 || !(aggregation.lower < aggregation.upper)
+                || (aggregation.logarithmic && !(aggregation.lower > 0))))
+        {
+            throw std::invalid_argument("AggregatingWriter: histogram " + aggregation.name + " has no bins or range");
+        }
+        if (aggregation.kind == Aggregation::Kind::Quantile
+            && !(aggregation.probability > 0 && aggregation.probability < 1))
+        {
+            throw std::invalid_argument("AggregatingWriter: quantile " + aggregation.name + " outside (0, 1)");
+        }
+        if ((aggregation.kind == Aggregation::Kind::ArgMin || aggregation.kind == Aggregation::Kind::ArgMax)
+            && !aggregation.argument)
+        {
+            throw std::invalid_argument("AggregatingWriter: " + aggregation.name + " has no argument");
+        }
+        if (!aggregation.quantity)
+        {
+            throw std::invalid_argument("AggregatingWriter: " + aggregation.name + " has no quantity");
+        }
+    }
+}
+
+
+AggregatingWriter::Group AggregatingWriter::newGroup() const
+{
+    Group group;
+    for (const auto& aggregation : aggregations)
+    {
+        Accumulator acc;
+        bool minimum = aggregation.kind == Aggregation::Kind::Min || aggregation.kind == Aggregation::Kind::ArgMin;
+        acc.extremum = minimum ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+        acc.argument = std::numeric_limits<double>::quiet_NaN();
+        if (aggregation.kind == Aggregation::Kind::Quantile)
+        {
+            acc.quantile.emplace_back(aggregation.probability);
+        }
+        if (aggregation.kind == Aggregation::Kind::Histogram)
+        {
+            acc.histogram.assign(aggregation.bins + 2, 0);
+        }
+        group.accumulators.push_back(std::move(acc));
+    }
+    return group;
+}
+
+
+void AggregatingWriter::add(Accumulator& acc, const Aggregation& aggregation, const SimulationResults& res) const
+{
+    double x = aggregation.quantity(res);
+    if (std::isnan(x))
+    {
+        return;
+    }
+    acc.count++;
+    acc.sum += x;
+
+    using Kind = Aggregation::Kind;
+    switch (aggregation.kind)
+    {
+        case Kind::Min:
+        case Kind::ArgMin:
+        case Kind::Max:
+        case Kind::ArgMax:
+        {
+            bool minimum = aggregation.kind == Kind::Min || aggregation.kind == Kind::ArgMin;
+            if (minimum ? x < acc.extremum : x > acc.extremum)
+            {
+                acc.extremum = x;
+                if (aggregation.argument)
+                {
+                    acc.argument = aggregation.argument(res);
+                }
+            }
+            break;
+        }
+        case Kind::Quantile:
+            acc.quantile.front().add(x);
+            break;
+        case Kind::Histogram:
+        {
+            // Bins from the lower end; a value on an edge is counted in the bin above it.
+            auto scale = [&](double v) {return aggregation.logarithmic ? std::log10(v) : v;};
+            double position = (scale(x) - scale(aggregation.lower)) * double(aggregation.bins)
+                            / (scale(aggregation.upper) - scale(aggregation.lower));
+            std::size_t bin = 0;
+            if (position >= double(aggregation.bins))
+            {
+                bin = aggregation.bins + 1;
+            }
+            else if (position >= 0.0)
+            {
+                bin = 1 + std::min(aggregation.bins - 1, static_cast<std::size_t>(position));
+            }
+            acc.histogram[bin]++;
+            break;
+        }
+        case Kind::Count:
+        case Kind::Mean:
+            break;
+    }
+}
+
+
+void AggregatingWriter::write(const SimulationResults& res)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        const auto& p = res.params;
+        std::array<double, 4> key{(groupBy & GroupBy::M) ? p.m : 0.0,
+                                  (groupBy & GroupBy::Lambda) ? p.lambda : 0.0,
+                                  (groupBy & GroupBy::B) ? p.b : 0.0,
+                                  (groupBy & GroupBy::Xi) ? p.xi : 0.0};
+        auto it = groups.find(key);
+        if (it == groups.end())
+        {
+            it = groups.emplace(key, newGroup()).first;
+        }
+        Group& group = it->second;
+        group.results++;
+        for (std::size_t i = 0; i < aggregations.size(); i++)
+        {
+            add(group.accumulators[i], aggregations[i], res);
+        }
+
+        if (emitInterval > 0 && ++sinceEmit >= emitInterval)
+        {
+            emitLocked();
+        }
+    }
+
+    if (forward)
+    {
+        forward->write(res);
+    }
+}
+
+
+std::string AggregatingWriter::tableLocked() const
+{
+    std::ostringstream ss;
+    const std::array<const char*, 4> keyNames{"m[GeV]", "lambda", "b", "xi"};
+    const std::array<unsigned, 4> keyFlags{GroupBy::M, GroupBy::Lambda, GroupBy::B, GroupBy::Xi};
+
+    // Header
+    for (std::size_t k = 0; k < keyNames.size(); k++)
+    {
+        if (groupBy & keyFlags[k])
+        {
+            ss << keyNames[k] << ',';
+        }
+    }
+    ss << "results";
+    for (const auto& aggregation : aggregations)
+    {
+        if (aggregation.kind != Aggregation::Kind::Histogram)
+        {
+            ss << ',' << aggregation.name;
+            continue;
+        }
+        // Bin columns named by their lower edges, rounded.
+        ss << ',' << aggregation.name << "<" << aggregation.lower;
+        for (std::size_t b = 0; b < aggregation.bins; b++)
+        {
+            double edge;
+            if (aggregation.logarithmic)
+            {
+                double lower = std::log10(aggregation.lower);
+                edge = std::pow(10.0, lower + double(b) * (std::log10(aggregation.upper) - lower) / double(aggregation.bins));
+            }
+            else
+            {
+                edge = aggregation.lower + double(b) * (aggregation.upper - aggregation.lower) / double(aggregation.bins);
+            }
+            ss << ',' << aggregation.name << ">=" << edge;
+        }
+        ss << ',' << aggregation.name << ">=" << aggregation.upper;
+    }
+    ss << "\n";
+
+    // One row per group, with the values in full precision.
+    ss.precision(std::numeric_limits<double>::max_digits10);
+    using Kind = Aggregation::Kind;
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    for (const auto& [key, group] : groups)
+    {
+        for (std::size_t k = 0; k < key.size(); k++)
+        {
+            if (groupBy & keyFlags[k])
+            {
+                ss << key[k] << ',';
+            }
+        }
+        ss << group.results;
+        for (std::size_t i = 0; i < aggregations.size(); i++)
+        {
+            const Accumulator& acc = group.accumulators[i];
+            switch (aggregations[i].kind)
+            {
+                case Kind::Count:
+                    ss << ',' << acc.count;
+                    break;
+                case Kind::Mean:
+                    ss << ',' << (acc.count > 0 ? acc.sum / double(acc.count) : nan);
+                    break;
+                case Kind::Min:
+                case Kind::Max:
+                    ss << ',' << (acc.count > 0 ? acc.extremum : nan);
+                    break;
+                case Kind::ArgMin:
+                case Kind::ArgMax:
+                    ss << ',' << acc.argument;
+                    break;
+                case Kind::Quantile:
+                    ss << ',' << acc.quantile.front().value();
+                    break;
+                case Kind::Histogram:
+                    for (std::size_t n : acc.histogram)
+                    {
+                        ss << ',' << n;
+                    }
+                    break;
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+
+std::string AggregatingWriter::table()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    return tableLocked();
+}
+
+
+/**
+ * Writes to a temporary file first and renames it over the previous summary, so that a
+ * reader or a crash never sees a partial table.
+ */
+void AggregatingWriter::emitLocked()
+{
+    sinceEmit = 0;
+    if (!std::filesystem::exists(outputDir))
+    {
+        std::filesystem::create_directory(outputDir);
+    }
+
+    path temporary = outputFile;
+    temporary += ".tmp";
+    {
+        std::ofstream fs(temporary, std::ios::trunc);
+        if (!fs.is_open())
+        {
+            throw std::runtime_error("Cannot open csv file.");
+        }
+        fs << tableLocked();
+    }
+    std::filesystem::rename(temporary, outputFile);
+}
+
+
+void AggregatingWriter::emit()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    emitLocked();
+}
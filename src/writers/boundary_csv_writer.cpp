@@ -0,0 +1,30 @@
+#include <ios>
+
+#include "writers/boundary_csv_writer.hpp"
+
+
+BoundaryCSVWriter::BoundaryCSVWriter(std::string file) : filename{file}
+{
+    if(!std::filesystem::exists(outputDir))
+    {
+        std::filesystem::create_directory(outputDir);
+    }
+
+    fs.open(outputFile, std::ios::app);
+    if(!fs.is_open())
+    {
+        throw std::runtime_error("Cannot open csv file.");
+    }
+
+    fs << "t0[GeV^-1],lambda,b,xi,G_N[GeV^-2],"
+          "m_transition[GeV],m_low[GeV],m_high[GeV],toMatterBelow,converged\n";
+};
+
+void BoundaryCSVWriter::write(const BoundaryPoint& b)
+{
+    fs << b.params.t0     << ',' << b.params.lambda << ',' << b.params.b   << ','
+       << b.params.xi     << ',' << b.params.G_N    << ','
+       << b.params.m      << ',' << b.mLow          << ',' << b.mHigh      << ','
+       << b.toMatterBelow << ',' << b.converged     << "\n";
+    fs.flush();
+}
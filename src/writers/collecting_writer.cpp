@@ -0,0 +1,23 @@
+#include "writers/collecting_writer.hpp"
+
+
+void CollectingWriter::write(const SimulationResults& res)
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        results.push_back(res);
+    }
+
+    if (forward)
+    {
+        forward->write(res);
+    }
+}
+
+std::vector<SimulationResults> CollectingWriter::take()
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    std::vector<SimulationResults> taken;
+    taken.swap(results);
+    return taken;
+}
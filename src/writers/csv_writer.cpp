@@ -24,12 +24,24 @@ CSVWriter::CSVWriter(std::string file) : filename{file}
     }
     
     // Write the csv header
-    fs << "t0[GeV^-1],m[GeV],lambda,b,xi,G_N[GeV^-2],"
+    fs << header() << "\n";
+};
+
+std::string CSVWriter::header()
+{
+    return "t0[GeV^-1],m[GeV],lambda,b,xi,G_N[GeV^-2],"
            "reheating_temp[GeV],reheating_time[1/GeV],"
            "t_eq[GeV^-1],rhoStiff_t_eq[GeV^4],rhoPhiStiff_t_eq[GeV^4],"
            "rhoChi_t_eq[GeV^4],tau_eq[GeV^-1],rhoPhiMatEq[GeV^4],rhoChiMatEq[GeV^4],"
-           "toMatter,bothFound\n";
-};
+           "toMatter,bothFound,t_eq_rad[GeV^-1],rhoPhiRadEq[GeV^4],rhoChiRadEq[GeV^4],status,"
+           "allocations,allocatedBytes,"
+           "dReheating_temp/dm,dReheating_temp/dlambda,dReheating_temp/db,dReheating_temp/dxi,"
+           "dReheating_time/dm,dReheating_time/dlambda,dReheating_time/db,dReheating_time/dxi,"
+           "dt_eq/dm,dt_eq/dlambda,dt_eq/db,dt_eq/dxi,"
+           "dtau_eq/dm,dtau_eq/dlambda,dtau_eq/db,dtau_eq/dxi,"
+           "approximate,approximationError,multipleCrossings,"
+           "t_eqQuadratureError,tau_eqQuadratureError,reheatingQuadratureError";
+}
 
 void CSVWriter::write(const SimulationResults& res)
 {
@@ -47,6 +59,17 @@ std::string CSVWriter::toCSVRow(const SimulationResults& r)
        << r.reheating_temp << ',' << r.reheating_time   << ',' << r.t_eq          << ','
        << r.rhoStiff_t_eq  << ',' << r.rhoPhiStiff_t_eq << ',' << r.rhoChi_t_eq   << ','
        << r.tau_eq         << ',' << r.rhoPhiMatEq      << ',' << r.rhoChiMatEq   << ','
-       << r.toMatter       << ',' << r.bothFound;
+       << r.toMatter       << ',' << r.bothFound        << ',' << r.t_eq_rad      << ','
+       << r.rhoPhiRadEq    << ',' << r.rhoChiRadEq      << ',' << statusName(r.status) << ','
+       << r.allocations    << ',' << r.allocatedBytes;
+    for (const auto& gradient : {r.dReheatingTemp, r.dReheatingTime, r.dt_eq, r.dtau_eq})
+    {
+        for (double d : gradient)
+        {
+            ss << ',' << d;
+        }
+    }
+    ss << ',' << r.approximate << ',' << r.approximationError << ',' << r.multipleCrossings;
+    ss << ',' << r.t_eqQuadratureError << ',' << r.tau_eqQuadratureError << ',' << r.reheatingQuadratureError;
     return ss.str();
 }
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <ios>
+
+#include "writers/profile_csv_writer.hpp"
+
+
+ProfileCSVWriter::ProfileCSVWriter(std::unique_ptr<ResultsWriter> forward_, std::string file)
+    : forward{std::move(forward_)}, filename{file}
+{
+    if(!std::filesystem::exists(outputDir))
+    {
+        std::filesystem::create_directory(outputDir);
+    }
+
+    fs.open(outputFile, std::ios::app);
+    if(!fs.is_open())
+    {
+        throw std::runtime_error("Cannot open csv file.");
+    }
+
+    fs << "m[GeV],lambda,b,xi,hardwareCounters";
+    for (std::size_t i = 0; i < static_cast<std::size_t>(ProfilePhase::Count); i++)
+    {
+        std::string name = phaseName(static_cast<ProfilePhase>(i));
+        for (const char* column : {"_calls", "_seconds", "_cycles", "_instructions", "_cacheMisses", "_branchMisses"})
+        {
+            fs << ',' << name << column;
+        }
+    }
+    fs << "\n";
+};
+
+void ProfileCSVWriter::write(const SimulationResults& res)
+{
+    if (res.profile)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        fs << res.params.m  << ',' << res.params.lambda << ',' << res.params.b << ','
+           << res.params.xi << ',' << res.profile->hardwareCounters;
+        for (const auto& c : res.profile->phases)
+        {
+            fs << ',' << c.calls        << ',' << c.nanoseconds * 1e-9 << ',' << c.cycles << ','
+               << c.instructions << ',' << c.cacheMisses        << ',' << c.branchMisses;
+        }
+        fs << "\n";
+        fs.flush();
+    }
+
+    if (forward)
+    {
+        forward->write(res);
+    }
+}
@@ -0,0 +1,43 @@
+#include <ios>
+
+#include "writers/trajectory_writer.hpp"
+
+
+TrajectoryWriter::TrajectoryWriter(std::string file) : filename{file}
+{
+    if(!std::filesystem::exists(outputDir))
+    {
+        std::filesystem::create_directory(outputDir);
+    }
+
+    fs.open(outputFile, std::ios::app | std::ios::binary);
+    if(!fs.is_open())
+    {
+        throw std::runtime_error("Cannot open trajectory file.");
+    }
+};
+
+void TrajectoryWriter::begin(const ModelParameters& p)
+{
+    const char magic[8] = {'R', 'H', 'T', 'R', 'A', 'J', '1', '\0'};
+    fs.write(magic, sizeof(magic));
+    for (double v : {p.t0, p.m, p.lambda, p.b, p.xi, p.G_N})
+    {
+        put(v);
+    }
+}
+
+void TrajectoryWriter::write(const TrajectoryPoint& point)
+{
+    put(static_cast<std::uint8_t>(point.epoch));
+    for (double v : {point.t, point.rhoStiff, point.rhoPhi, point.rhoChi})
+    {
+        put(v);
+    }
+}
+
+void TrajectoryWriter::end()
+{
+    put(endMarker);
+    fs.flush();
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+#include <boost/math/special_functions/bessel.hpp>
+#include <model/energy/creation_decay.hpp>
+
+TEST(ChiDecayRateTest, MatchesDerivativeJustAboveInitialTime) {
+    ModelParameters p;
+    p.m = 1e3;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+    const double n = 1.0;
+    ChiDecayRate chiDecay(p, n, p.t0);
+
+    // d/dt of the decay rate is lambda^2 t (J_a^2 + N_a^2)(m t) / 32 (Lommel's integral).
+    double alpha = p.alpha(n);
+    double arg = p.m * p.t0;
+    double J = boost::math::cyl_bessel_j(alpha, arg);
+    double N = boost::math::cyl_neumann(alpha, arg);
+    double derivative = p.lambda * p.lambda * p.t0 * (J * J + N * N) / 32.0;
+
+    double h = p.t0 * 1e-9;
+    double expected = derivative * h;
+
+    EXPECT_NEAR(chiDecay(p.t0 + h), expected, 1e-6 * expected);
+}
+
+TEST(ChiDecayRateTest, ChannelsWithSharedAlphaCombineCouplings) {
+    ModelParameters single;
+    single.m = 1e3;
+    single.lambda = sqrt(0.01 * 0.01 + 0.02 * 0.02);
+    single.b = 1.0;
+    single.xi = 0.0;
+
+    ModelParameters multi = single;
+    multi.channels = {{0.01, 0.0}, {0.02, 0.0}, {0.03, 1.0 / 6.0}};
+    ModelParameters conformal = single;
+    conformal.lambda = 0.03;
+    conformal.xi = 1.0 / 6.0;
+
+    const double n = 1.0;
+    ChiDecayRate singleRate(single, n, single.t0);
+    ChiDecayRate multiRate(multi, n, multi.t0);
+    ChiDecayRate conformalRate(conformal, n, conformal.t0);
+
+    double t = 1e3 * single.t0;
+    double total = multiRate(t);
+
+    EXPECT_EQ(multiRate.channelCount(), 3u);
+    EXPECT_NEAR(total, singleRate(t) + conformalRate(t), 1e-12 * std::abs(total));
+    EXPECT_NEAR(total, multiRate.channel(0, t) + multiRate.channel(1, t) + multiRate.channel(2, t),
+                1e-12 * std::abs(total));
+}
@@ -4,21 +4,22 @@
 
 TEST(ChiParticleTest, EnergyDensityMatterMonotonicDecrease) {
     ModelParameters p;
-    p.t0 = HighPrecision("1e-32");
-    p.m = HighPrecision("1e36");
-    p.lambda = HighPrecision("0.001");
-    p.b = HighPrecision("1.0");
+    p.t0 = 1e-32;
+    p.m = 1e36;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
     std::shared_ptr<PhiParticle> phi = std::make_shared<PhiParticle>(p);
     ChiParticle chi{p, phi};
-    chi.setInitialRhoMatter(HighPrecision("1e-10"));
+    chi.setInitialRhoMatter(1e-10);
 
     auto rho = chi.energyDensityMatter(p.t0);
 
-    HighPrecision t1("1e-28");
-    HighPrecision t2("2e-28");
+    double t1 = 1e-28;
+    double t2 = 2e-28;
 
-    HighPrecision val1 = rho(t1);
-    HighPrecision val2 = rho(t2);
+    double val1 = rho(t1);
+    double val2 = rho(t2);
 
     EXPECT_GT(val1, val2);  // Should decrease with time
 }
\ No newline at end of file
@@ -1,43 +1,88 @@
 #include <gtest/gtest.h>
 #include <model/particles/phi_particle.hpp>
+#include <model/particles/phase_context.hpp>
 
 TEST(PhiParticleTest, EnergyDensityMatterMonotonicDecrease) {
     ModelParameters p;
-    p.t0 = HighPrecision("1e-32");
-    p.m = HighPrecision("1e36");
-    p.lambda = HighPrecision("0.001");
-    p.b = HighPrecision("1.0");
+    p.t0 = 1e-32;
+    p.m = 1e36;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
     PhiParticle phi{p};
-    phi.setInitialRhoMatter(HighPrecision("1e-10"));
+    phi.setInitialRhoMatter(1e-10);
 
     auto rho = phi.energyDensityMatter(p.t0);
 
-    HighPrecision t1("1e-28");
-    HighPrecision t2("2e-28");
+    double t1 = 1e-28;
+    double t2 = 2e-28;
 
-    HighPrecision val1 = rho(t1);
-    HighPrecision val2 = rho(t2);
+    double val1 = rho(t1);
+    double val2 = rho(t2);
 
     EXPECT_GT(val1, val2);  // Should decrease with time
 }
 
 TEST(PhiParticleTest, EnergyDensityRadiationMonotonicDecrease) {
     ModelParameters p;
-    p.t0 = HighPrecision("1e-32");
-    p.m = HighPrecision("1e36");
-    p.lambda = HighPrecision("0.001");
-    p.b = HighPrecision("1.0");
+    p.t0 = 1e-32;
+    p.m = 1e36;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
     PhiParticle phi{p};
-    phi.setInitialRhoRadiation(HighPrecision("1e-10"));
+    phi.setInitialRhoRadiation(1e-10);
 
     auto rho = phi.energyDensityRadiation(p.t0);
 
-    HighPrecision t1("1e-28");
-    HighPrecision t2("2e-28");
+    double t1 = 1e-28;
+    double t2 = 2e-28;
 
-    HighPrecision val1 = rho(t1);
-    HighPrecision val2 = rho(t2);
+    double val1 = rho(t1);
+    double val2 = rho(t2);
 
     EXPECT_GT(val1, val2);  // Should decrease with time
 }
 
+
+TEST(PhiParticleTest, StiffDerivativeMatchesFiniteDifference) {
+    ModelParameters p;
+    p.m = 1e6;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+    PhiParticle phi{p};
+
+    auto rho = phi.energyDensityStiff();
+    auto drho = phi.energyDensityStiffDerivative();
+
+    double t = 1e3 * p.t0;
+    double h = 1e-5 * t;
+    double expected = (rho(t + h) - rho(t - h)) / (2.0 * h);
+
+    EXPECT_NEAR(drho(t, rho(t)), expected, 1e-6 * std::abs(expected));
+}
+
+
+TEST(PhiParticleTest, PhaseContextSharedUntilInitialDensityChanges) {
+    ModelParameters p;
+    p.t0 = 1e-32;
+    p.m = 1e36;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
+    PhiParticle phi{p};
+    phi.setInitialRhoMatter(1e-10);
+
+    auto context = phi.phaseContext<Epoch::Matter>(p.t0);
+    EXPECT_EQ(phi.phaseContext<Epoch::Matter>(p.t0), context);
+    EXPECT_NE(phi.phaseContext<Epoch::Matter>(2 * p.t0), context);
+
+    // The closures keep the context they were made with.
+    auto rho = phi.energyDensityMatter(p.t0);
+    double before = rho(1e-28);
+    phi.setInitialRhoMatter(2e-10);
+    EXPECT_NE(phi.phaseContext<Epoch::Matter>(p.t0), context);
+    EXPECT_DOUBLE_EQ(rho(1e-28), before);
+    EXPECT_DOUBLE_EQ(phi.energyDensityMatter(p.t0)(1e-28), 2 * before);
+}
@@ -0,0 +1,22 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <model/epoch.hpp>
+
+template<Epoch E>
+void expectScaleFactorPowers(double t)
+{
+    using Traits = EpochTraits<E>;
+    double exponent = Traits::n / (Traits::n + 2.0);
+    EXPECT_NEAR(Traits::a3(t), std::pow(t, 3.0 * exponent), 1e-14 * std::pow(t, 3.0 * exponent));
+    EXPECT_NEAR(Traits::a4(t), std::pow(t, 4.0 * exponent), 1e-14 * std::pow(t, 4.0 * exponent));
+}
+
+TEST(EpochTraitsTest, ScaleFactorPowersMatchGenericPow) {
+    for (double t : {1e-8, 0.37, 2.0, 1e12})
+    {
+        expectScaleFactorPowers<Epoch::Minkowski>(t);
+        expectScaleFactorPowers<Epoch::Stiff>(t);
+        expectScaleFactorPowers<Epoch::Radiation>(t);
+        expectScaleFactorPowers<Epoch::Matter>(t);
+    }
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <simulation/analytic_estimate.hpp>
+
+TEST(AnalyticEstimateTest, MatchesSimulationWithinItsError) {
+    // Radiation and matter domination after the stiff phase.
+    for (auto [m, lambda] : {std::pair{1e3, 0.01}, std::pair{1e5, 1e-4}})
+    {
+        ModelParameters p;
+        p.m = m;
+        p.lambda = lambda;
+        p.b = 1.0;
+        p.xi = 0.0;
+
+        auto estimate = AnalyticEstimate(p).run();
+        ASSERT_TRUE(estimate.has_value());
+        EXPECT_TRUE(estimate->approximate);
+
+        SimulationResults res = Simulation(p).run();
+        double error = estimate->approximationError;
+        EXPECT_LT(error, 1e-2);
+        EXPECT_EQ(estimate->toMatter, res.toMatter);
+        EXPECT_NEAR(estimate->t_eq, res.t_eq, error * res.t_eq);
+        EXPECT_NEAR(estimate->tau_eq, res.tau_eq, error * res.tau_eq);
+        EXPECT_NEAR(estimate->reheating_temp, res.reheating_temp, error * res.reheating_temp);
+    }
+}
+
+TEST(AnalyticEstimateTest, DeclinesSeveralChannels) {
+    ModelParameters p;
+    p.m = 1e3;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+    p.channels = {DecayChannel{0.01, 0.0}, DecayChannel{0.001, 1.0 / 6.0}};
+
+    EXPECT_FALSE(AnalyticEstimate(p).run().has_value());
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <simulation/batch.hpp>
+
+TEST(SimulateBatchTest, FillsResultsInParameterOrder) {
+    ModelParameters p;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+
+    std::vector<ModelParameters> params;
+    for (double m : {1e6, 1e3, 1e6})
+    {
+        p.m = m;
+        params.push_back(p);
+    }
+    std::vector<SimulationResults> results(params.size());
+
+    std::size_t calls = 0;
+    BatchOptions options;
+    options.threads = 2;
+    options.outputs = Outputs::StiffEquality;
+    options.progress = [&](std::size_t done, std::size_t total)
+    {
+        calls++;
+        EXPECT_EQ(done, calls);
+        EXPECT_EQ(total, params.size());
+    };
+    simulateBatch(params, results, options);
+
+    EXPECT_EQ(calls, params.size());
+    for (std::size_t i = 0; i < params.size(); i++)
+    {
+        EXPECT_EQ(results[i].params, params[i]);
+        EXPECT_EQ(results[i].status, SimulationStatus::Ok);
+    }
+    EXPECT_EQ(results[0].t_eq, results[2].t_eq);
+    EXPECT_NE(results[0].t_eq, results[1].t_eq);
+}
+
+TEST(SimulateBatchTest, RejectsMismatchedSizes) {
+    std::vector<ModelParameters> params(2);
+    std::vector<SimulationResults> results(1);
+    EXPECT_THROW(simulateBatch(params, results), std::invalid_argument);
+}
+
+TEST(SimulateBatchTest, RunsAtTheRequestedPrecision) {
+    ModelParameters p;
+    p.m = 1e6;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+    std::vector<ModelParameters> params{p};
+    std::vector<SimulationResults> strict(1);
+    std::vector<SimulationResults> loose(1);
+
+    BatchOptions options;
+    options.threads = 1;
+    simulateBatch(params, strict, options);
+    options.precision = PrecisionTargets{.equalityTime = 1e-3, .reheatingTemp = 1e-3};
+    simulateBatch(params, loose, options);
+
+    // The stiff phase meets either budget on its first panels; the matter phase does not.
+    ASSERT_EQ(loose[0].status, SimulationStatus::Ok);
+    ASSERT_TRUE(loose[0].toMatter);
+    EXPECT_LE(strict[0].tau_eqQuadratureError, 1e-8);
+    EXPECT_LE(loose[0].tau_eqQuadratureError, 1e-3);
+    EXPECT_GT(loose[0].tau_eqQuadratureError, strict[0].tau_eqQuadratureError);
+    EXPECT_NEAR(loose[0].tau_eq, strict[0].tau_eq, 1e-3 * strict[0].tau_eq);
+}
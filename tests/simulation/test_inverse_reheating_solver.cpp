@@ -0,0 +1,35 @@
+#include <gtest/gtest.h>
+#include <simulation/inverse_reheating_solver.hpp>
+
+TEST(InverseReheatingSolverTest, FindsMassOfTargetTemperature) {
+    ModelParameters p;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
+
+    InverseSolverSettings settings;
+    settings.mMin = 1e11;
+    settings.mMax = 1e13;
+    InverseReheatingSolver solver(p, settings);
+    // T_RH falls with m here, from about 1.5e8 GeV to 8.3e7 GeV.
+    const double target = 1.2e8;
+    auto solutions = solver.solve(target);
+
+    ASSERT_EQ(solutions.size(), 1u);
+    const auto& solution = solutions.front();
+    EXPECT_TRUE(solution.converged);
+    EXPECT_FALSE(solution.atSwitch);
+    EXPECT_LE(solution.temperatureError, settings.temperatureTolerance);
+    EXPECT_GE(solution.params.m, solution.mLow);
+    EXPECT_LE(solution.params.m, solution.mHigh);
+
+    p.m = solution.params.m;
+    SimulationResults res = Simulation(p).run();
+    EXPECT_NEAR(res.reheating_temp, target, 2 * settings.temperatureTolerance * target);
+
+    // Solving again reuses the simulations.
+    std::size_t count = solver.getSimulationCount();
+    EXPECT_LE(count, 10u);
+    EXPECT_EQ(solver.solve(target).size(), 1u);
+    EXPECT_EQ(solver.getSimulationCount(), count);
+}
@@ -0,0 +1,92 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <simulation/simulation.hpp>
+
+TEST(SensitivityTest, MatchesFiniteDifferences) {
+    ModelParameters p;
+    p.m = 1e3;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.1;
+
+    Simulation sim(p);
+    SimulationResults res = sim.run(Outputs::Sensitivities);
+    ASSERT_FALSE(res.toMatter);
+
+    // Central differences in m and lambda.
+    for (std::size_t i : {0, 1})
+    {
+        ModelParameters up = p;
+        ModelParameters down = p;
+        double& upValue = (i == 0) ? up.m : up.lambda;
+        double& downValue = (i == 0) ? down.m : down.lambda;
+        double h = 1e-5 * upValue;
+        upValue += h;
+        downValue -= h;
+        Simulation simUp(up);
+        Simulation simDown(down);
+        SimulationResults resUp = simUp.run();
+        SimulationResults resDown = simDown.run();
+
+        double dt_eq = (resUp.t_eq - resDown.t_eq) / (2.0 * h);
+        double dTemp = (resUp.reheating_temp - resDown.reheating_temp) / (2.0 * h);
+        EXPECT_NEAR(res.dt_eq[i], dt_eq, 1e-4 * std::abs(dt_eq));
+        EXPECT_NEAR(res.dReheatingTemp[i], dTemp, 1e-4 * std::abs(dTemp));
+    }
+}
+
+TEST(SensitivityTest, MatchesFiniteDifferencesThroughMatter) {
+    ModelParameters p;
+    p.m = 1e8;
+    p.lambda = 1e-5;
+    p.b = 1.0;
+    p.xi = 0.1;
+
+    Simulation sim(p);
+    SimulationResults res = sim.run(Outputs::Sensitivities);
+    ASSERT_TRUE(res.toMatter);
+
+    // Central differences in m, lambda, b and xi, with a step of 1% at which they converge.
+    // Derivatives whose effect over the whole parameter is below the rounding of the run
+    // (1e-12 relative) only have to vanish, like those in xi at this mass.
+    auto parameter = [](ModelParameters& q, std::size_t i) -> double&
+    {
+        double* values[] = {&q.m, &q.lambda, &q.b, &q.xi};
+        return *values[i];
+    };
+    for (std::size_t i = 0; i < 4; i++)
+    {
+        ModelParameters up = p;
+        ModelParameters down = p;
+        double h = 1e-2 * parameter(up, i);
+        parameter(up, i) += h;
+        parameter(down, i) -= h;
+        Simulation simUp(up);
+        Simulation simDown(down);
+        SimulationResults resUp = simUp.run();
+        SimulationResults resDown = simDown.run();
+
+        auto expectDerivative = [&](double dual, double valueUp, double valueDown, double value)
+        {
+            double difference = (valueUp - valueDown) / (2.0 * h);
+            double tolerance = 1e-3 * std::abs(difference) + 1e-12 * std::abs(value / parameter(p, i));
+            EXPECT_NEAR(dual, difference, tolerance) << "parameter " << i;
+        };
+        expectDerivative(res.dt_eq[i], resUp.t_eq, resDown.t_eq, res.t_eq);
+        expectDerivative(res.dtau_eq[i], resUp.tau_eq, resDown.tau_eq, res.tau_eq);
+        expectDerivative(res.dReheatingTemp[i], resUp.reheating_temp, resDown.reheating_temp,
+                         res.reheating_temp);
+    }
+}
+
+TEST(SensitivityTest, NotComputedByDefault) {
+    ModelParameters p;
+    p.m = 1e3;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+
+    Simulation sim(p);
+    SimulationResults res = sim.run(Outputs::StiffEquality);
+    EXPECT_TRUE(std::isnan(res.dt_eq[0]));
+}
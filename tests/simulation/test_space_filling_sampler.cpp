@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <set>
+#include <simulation/space_filling_sampler.hpp>
+
+TEST(SpaceFillingSamplerTest, SequencesStayInRangeAndResume) {
+    ModelParameters base;
+    base.xi = 1.0 / 6.0;
+
+    for (auto method : {SamplingMethod::Sobol, SamplingMethod::Halton})
+    {
+        SamplerSettings settings;
+        settings.method = method;
+        settings.budget = 64;
+        SpaceFillingSampler sampler(base, settings);
+
+        auto all = sampler.points();
+        auto resumed = sampler.points(40);
+        ASSERT_EQ(all.size(), 64u);
+        ASSERT_EQ(resumed.size(), 24u);
+        EXPECT_EQ(resumed.front(), all[40]);
+
+        for (const auto& p : all)
+        {
+            EXPECT_GE(p.m, settings.mMin);
+            EXPECT_LT(p.m, settings.mMax);
+            EXPECT_GE(p.lambda, settings.lambdaMin);
+            EXPECT_LT(p.lambda, settings.lambdaMax);
+            EXPECT_GE(p.b, settings.bMin);
+            EXPECT_LT(p.b, settings.bMax);
+            EXPECT_EQ(p.xi, base.xi);
+        }
+    }
+}
+
+TEST(SpaceFillingSamplerTest, LatinHypercubeFillsEveryStratum) {
+    SamplerSettings settings;
+    settings.method = SamplingMethod::LatinHypercube;
+    settings.budget = 50;
+    settings.seed = 7;
+    SpaceFillingSampler sampler(ModelParameters{}, settings);
+
+    std::set<int> mStrata;
+    std::set<int> lambdaStrata;
+    for (const auto& p : sampler.points())
+    {
+        double u = std::log10(p.m / settings.mMin) / std::log10(settings.mMax / settings.mMin);
+        double v = std::log10(p.lambda / settings.lambdaMin) / std::log10(settings.lambdaMax / settings.lambdaMin);
+        mStrata.insert(static_cast<int>(u * settings.budget));
+        lambdaStrata.insert(static_cast<int>(v * settings.budget));
+    }
+    EXPECT_EQ(mStrata.size(), settings.budget);
+    EXPECT_EQ(lambdaStrata.size(), settings.budget);
+    EXPECT_THROW(sampler.point(settings.budget), std::out_of_range);
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <simulation/trajectory.hpp>
+
+TEST(TrajectoryTest, JoinsTheEqualityPoints) {
+    ModelParameters p;
+    p.m = 1e12;
+    p.lambda = 0.001;
+    p.b = 1.0;
+    p.xi = 0.0;
+
+    Simulation sim(p);
+    SimulationResults res = sim.run();
+    ASSERT_TRUE(res.toMatter);
+
+    std::vector<TrajectoryPoint> points;
+    TrajectoryTracer(p).trace(res, [&](const TrajectoryPoint& point) {points.push_back(point);});
+
+    ASSERT_GT(points.size(), 100u);
+    EXPECT_EQ(points.front().epoch, Epoch::Stiff);
+    EXPECT_EQ(points.back().epoch, Epoch::Radiation);
+    for (std::size_t i = 1; i < points.size(); i++)
+    {
+        ASSERT_GT(points[i].t, points[i - 1].t * (1 - 1e-12));
+        if (points[i].epoch == Epoch::Matter && points[i - 1].epoch == Epoch::Stiff)
+        {
+            // The stiff sweep ends on the values the simulation found at t_eq.
+            EXPECT_NEAR(points[i - 1].rhoPhi, res.rhoPhiStiff_t_eq, 1e-6 * res.rhoPhiStiff_t_eq);
+            EXPECT_NEAR(points[i - 1].rhoChi, res.rhoChi_t_eq, 1e-6 * res.rhoChi_t_eq);
+        }
+    }
+}
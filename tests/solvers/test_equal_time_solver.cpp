@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <limits>
+#include <solvers/equal_time_solver.hpp>
+
+TEST(EqualTimeSolverTest, FindsCrossing) {
+    EnergyDensity rho1 = [](double t) {return 1.0 / (t * t);};
+    EnergyDensity rho2 = [](double t) {return 1e-4 / t;};
+
+    EqualTime equality = EqualTimeSolver(rho1, rho2, 1.0).solve();
+    ASSERT_TRUE(equality.found());
+    EXPECT_NEAR(equality.t, 1e4, 1e-6 * 1e4);
+}
+
+TEST(EqualTimeSolverTest, ReportsMissingCrossing) {
+    EnergyDensity rho1 = [](double t) {return 1.0 / (t * t);};
+    EnergyDensity rho2 = [](double t) {return 1e-4 / (t * t);};
+
+    EqualTime equality = EqualTimeSolver(rho1, rho2, 1.0).solve();
+    EXPECT_EQ(equality.status, RootStatus::NoBracket);
+    EXPECT_TRUE(std::isnan(equality.t));
+}
+
+TEST(EqualTimeSolverTest, ReportsNonFiniteDensity) {
+    EnergyDensity rho1 = [](double t) {return 1.0 / (t * t);};
+    EnergyDensity rho2 = [](double t) {return t < 1e3 ? 1e-4 / t : std::numeric_limits<double>::quiet_NaN();};
+
+    EqualTime equality = EqualTimeSolver(rho1, rho2, 1.0).solve();
+    EXPECT_EQ(equality.status, RootStatus::NonFinite);
+}
+
+TEST(EqualTimeSolverTest, FindsEarliestOfSeveralCrossings) {
+    // log rho1 - log rho2 = (s - log 2)(s - log 3)(s - log 5), s = log t: three crossings in
+    // the decade [1, 10].
+    auto cubic = [](double t) {return (log(t) - log(2.0)) * (log(t) - log(3.0)) * (log(t) - log(5.0));};
+    EnergyDensity rho1 = [&](double t) {return std::exp(cubic(t));};
+    EnergyDensity rho2 = [](double) {return 1.0;};
+    EnergyDensityDerivative drho1 = [](double t, double rho)
+    {
+        double a = log(t) - log(2.0);
+        double b = log(t) - log(3.0);
+        double c = log(t) - log(5.0);
+        return rho * (a * b + b * c + a * c) / t;
+    };
+    EnergyDensityDerivative drho2 = [](double, double) {return 0.0;};
+
+    for (EqualTimeSolver solver : {EqualTimeSolver(rho1, rho2, 1.0),
+                                   EqualTimeSolver(rho1, drho1, rho2, drho2, 1.0)})
+    {
+        EqualTime equality = solver.solve();
+        ASSERT_TRUE(equality.found());
+        EXPECT_NEAR(equality.t, 2.0, 1e-10);
+        EXPECT_EQ(equality.crossings, 3u);
+    }
+}
@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <storage/result_store.hpp>
+
+namespace
+{
+
+std::string storePath(const std::string& name)
+{
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove(path);
+    return path.string();
+}
+
+SimulationResults sampleResults(double m)
+{
+    SimulationResults res;
+    res.params.m = m;
+    res.params.lambda = 0.01;
+    res.params.b = 1.0;
+    res.params.xi = 0.0;
+    res.t_eq = 2.0 * m;
+    res.toMatter = true;
+    res.bothFound = false;
+    res.rhoChiChannels_t_eq = {1.0, 2.0};
+    res.t_eqQuadratureError = 1e-10;
+    return res;
+}
+
+}
+
+TEST(ResultStoreTest, ReopenedStoreReturnsStoredResults) {
+    std::string path = storePath("reheating_test_reopen.store");
+    {
+        ResultStore store(path);
+        store.store(sampleResults(1e3), Outputs::Default);
+        store.store(sampleResults(1e4), Outputs::Default);
+    }
+
+    ResultStore store(path);
+    EXPECT_EQ(store.size(), 2u);
+
+    auto hit = store.lookup(sampleResults(1e4).params, Outputs::Default);
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(hit->t_eq, 2e4);
+    EXPECT_TRUE(hit->toMatter);
+    EXPECT_EQ(hit->rhoChiChannels_t_eq, std::vector<double>({1.0, 2.0}));
+    EXPECT_TRUE(std::isnan(hit->tau_eq));
+    EXPECT_EQ(hit->t_eqQuadratureError, 1e-10);
+
+    EXPECT_FALSE(store.lookup(sampleResults(1e5).params, Outputs::Default).has_value());
+    EXPECT_FALSE(store.lookup(sampleResults(1e4).params, Outputs::All).has_value());
+    std::filesystem::remove(path);
+}
+
+TEST(ResultStoreTest, TornRecordIsDropped) {
+    std::string path = storePath("reheating_test_torn.store");
+    {
+        ResultStore store(path);
+        store.store(sampleResults(1e3), Outputs::Default);
+    }
+    auto intactSize = std::filesystem::file_size(path);
+    {
+        // A crash in the middle of an append.
+        std::ofstream file(path, std::ios::app | std::ios::binary);
+        file << "partial record";
+    }
+
+    {
+        ResultStore store(path);
+        EXPECT_EQ(store.size(), 1u);
+        EXPECT_EQ(std::filesystem::file_size(path), intactSize);
+        store.store(sampleResults(1e4), Outputs::Default);
+    }
+
+    ResultStore store(path);
+    EXPECT_EQ(store.size(), 2u);
+    std::filesystem::remove(path);
+}
+
+TEST(ResultStoreTest, PrecisionIsPartOfTheKey) {
+    std::string path = storePath("reheating_test_precision.store");
+    PrecisionTargets loose{.equalityTime = 1e-4, .reheatingTemp = 1e-4};
+    {
+        ResultStore store(path);
+        store.store(sampleResults(1e3), Outputs::Default, loose);
+    }
+
+    ResultStore store(path);
+    EXPECT_FALSE(store.lookup(sampleResults(1e3).params, Outputs::Default).has_value());
+    auto hit = store.lookup(sampleResults(1e3).params, Outputs::Default, loose);
+    ASSERT_TRUE(hit.has_value());
+    EXPECT_EQ(hit->t_eq, 2e3);
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <utils/integration.hpp>
+
+TEST(IntegrationTest, MeetsBudgetAndBoundsError) {
+    // A narrow peak early in a range of many decades, like the creation peak of rho_phi.
+    const double c = 1e-3;
+    const double lower = 1e-5;
+    const double upper = 1e3;
+    auto f = [&](double t) {return std::exp(-std::pow(std::log(t / c), 2)) + 1e-6 * t;};
+    auto peak = [&](double t) {return std::erf(std::log(t / c) - 0.5);};
+    double exact = c * std::exp(0.25) * std::sqrt(std::acos(-1.0)) / 2 * (peak(upper) - peak(lower))
+                 + 0.5e-6 * (upper * upper - lower * lower);
+
+    IntegrationUtils::ErrorBudget budget{.relative = 1e-10};
+    IntegrationUtils::ErrorTally tally;
+    double error = 0.0;
+    double result = IntegrationUtils::integrate(f, lower, upper, budget, &error);
+
+    EXPECT_LE(error, budget.relative * std::abs(result));
+    EXPECT_LE(std::abs(result - exact), error + 1e-14 * exact);
+    EXPECT_DOUBLE_EQ(tally.largest(), error / std::abs(result));
+}
+
+TEST(IntegrationTest, NestedErrorsAreIncluded) {
+    IntegrationUtils::ErrorBudget budget{.relative = 1e-9};
+    auto inner = [&](double t)
+    {
+        IntegrationUtils::ErrorTally::record(1e-6);
+        return t;
+    };
+    double error = 0.0;
+    double result = IntegrationUtils::integrate(inner, 0.0, 1.0, budget, &error);
+
+    EXPECT_NEAR(result, 0.5, 1e-14);
+    EXPECT_GE(error, 1e-6 * result * (1 - 1e-12));
+}
+
+TEST(IntegrationTest, NaNIntegrandIsNotBisected) {
+    std::size_t evaluations = 0;
+    auto f = [&](double t)
+    {
+        evaluations++;
+        return t < 0.5 ? std::nan("") : t;
+    };
+    double error = 0.0;
+    double result = IntegrationUtils::integrate(f, 0.0, 1.0, IntegrationUtils::ErrorBudget{}, &error);
+
+    EXPECT_TRUE(std::isnan(result));
+    EXPECT_TRUE(std::isnan(error));
+    EXPECT_EQ(evaluations, 31u);    // The first panel only
+
+    evaluations = 0;
+    auto joint = [&](double t) -> std::array<double, 2> {return {f(t), t};};
+    auto [nan, finite] = IntegrationUtils::integrateJointly<2>(joint, 0.0, 1.0);
+    EXPECT_TRUE(std::isnan(nan));
+    EXPECT_NEAR(finite, 0.5, 1e-14);
+    EXPECT_EQ(evaluations, 31u);
+}
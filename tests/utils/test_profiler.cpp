@@ -0,0 +1,23 @@
+#include <gtest/gtest.h>
+#include <simulation/simulation.hpp>
+#include <utils/profiler.hpp>
+
+TEST(ProfilerTest, AttributesPhasesOfARun) {
+    ModelParameters p;
+    p.m = 1e3;
+    p.lambda = 0.01;
+    p.b = 1.0;
+    p.xi = 0.0;
+
+    RunProfile profile;
+    {
+        Profiler profiler(profile);
+        Simulation sim(p);
+        sim.run();
+    }
+    EXPECT_EQ(profile.hardwareCounters, Profiler::countersAvailable());
+    EXPECT_EQ(profile[ProfilePhase::Stiff].calls, 1u);
+    EXPECT_EQ(profile[ProfilePhase::Reheating].calls, 1u);
+    EXPECT_GT(profile[ProfilePhase::Decay].calls, 0u);
+    EXPECT_GT(profile[ProfilePhase::Stiff].nanoseconds, 0u);
+}
@@ -0,0 +1,86 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <writers/aggregating_writer.hpp>
+
+TEST(AggregatingWriterTest, SummarizesEachGroup) {
+    using Kind = Aggregation::Kind;
+    auto temperature = [](const SimulationResults& r) {return r.reheating_temp;};
+    auto mass = [](const SimulationResults& r) {return r.params.m;};
+    auto matter = [](const SimulationResults& r) {return double(r.toMatter);};
+    AggregatingWriter writer(GroupBy::Lambda, {
+        {.kind = Kind::Max, .name = "max", .quantity = temperature},
+        {.kind = Kind::ArgMax, .name = "m_max", .quantity = temperature, .argument = mass},
+        {.kind = Kind::Mean, .name = "toMatter", .quantity = matter},
+        {.kind = Kind::Quantile, .name = "median", .quantity = temperature, .probability = 0.5},
+        {.kind = Kind::Histogram, .name = "T", .quantity = temperature, .lower = 1.0, .upper = 1e3, .bins = 3,
+         .logarithmic = true},
+    });
+
+    // T_RH = 1..1001 in random order for lambda = 0.1, a single failed run for lambda = 0.2.
+    std::vector<double> temperatures(1001);
+    for (std::size_t i = 0; i < temperatures.size(); i++)
+    {
+        temperatures[i] = double(i + 1);
+    }
+    std::shuffle(temperatures.begin(), temperatures.end(), std::mt19937(1));
+    for (double t : temperatures)
+    {
+        SimulationResults res;
+        res.params.lambda = 0.1;
+        res.params.m = 2.0 * t;
+        res.reheating_temp = t;
+        res.toMatter = t <= 250.0;
+        writer.write(res);
+    }
+    SimulationResults failed;
+    failed.params.lambda = 0.2;
+    failed.status = SimulationStatus::Failed;
+    writer.write(failed);
+
+    std::istringstream table(writer.table());
+    std::string header;
+    std::getline(table, header);
+    EXPECT_EQ(header, "lambda,results,max,m_max,toMatter,median,T<1,T>=1,T>=10,T>=100,T>=1000");
+
+    std::vector<std::vector<double>> rows;
+    for (std::string line; std::getline(table, line);)
+    {
+        std::vector<double> row;
+        std::istringstream cells(line);
+        for (std::string cell; std::getline(cells, cell, ',');)
+        {
+            row.push_back(std::stod(cell));
+        }
+        rows.push_back(row);
+    }
+    ASSERT_EQ(rows.size(), 2u);
+
+    const auto& first = rows[0];
+    EXPECT_EQ(first[0], 0.1);
+    EXPECT_EQ(first[1], 1001);
+    EXPECT_EQ(first[2], 1001);
+    EXPECT_EQ(first[3], 2002);
+    EXPECT_NEAR(first[4], 250.0 / 1001.0, 1e-15);
+    EXPECT_NEAR(first[5], 501, 10);
+    EXPECT_EQ(std::vector<double>(first.begin() + 6, first.end()), (std::vector<double>{0, 9, 90, 900, 2}));
+
+    // A group without values of the quantity still counts its results.
+    const auto& second = rows[1];
+    EXPECT_EQ(second[0], 0.2);
+    EXPECT_EQ(second[1], 1);
+    EXPECT_TRUE(std::isnan(second[2]));
+    EXPECT_EQ(second[4], 0);
+}
+
+TEST(AggregatingWriterTest, RejectsInvalidAggregations) {
+    auto temperature = [](const SimulationResults& r) {return r.reheating_temp;};
+    EXPECT_THROW(AggregatingWriter(GroupBy::None, {{.kind = Aggregation::Kind::ArgMax, .name = "m", .quantity = temperature}}),
+                 std::invalid_argument);
+    EXPECT_THROW(AggregatingWriter(GroupBy::None, {{.kind = Aggregation::Kind::Histogram, .name = "T", .quantity = temperature,
+                                                    .lower = 0.0, .upper = 1.0, .logarithmic = true}}),
+                 std::invalid_argument);
+}